@@ -32,3 +32,24 @@
 #else
 #define STRICTINLINE inline
 #endif
+
+// alignment
+#ifdef _MSC_VER
+#define ALIGNED(n) __declspec(align(n))
+#elif defined(__GNUC__)
+#define ALIGNED(n) __attribute__((aligned(n)))
+#elif defined(__cplusplus)
+#define ALIGNED(n) alignas(n)
+#else
+#define ALIGNED(n) _Alignas(n)
+#endif
+
+// size of a cache line, which data written by different threads is aligned
+// and padded to
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED ALIGNED(CACHE_LINE_SIZE)
+
+// SIMD support
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2
+#endif
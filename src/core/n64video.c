@@ -1,4 +1,5 @@
 #include "n64video.h"
+#include "n64video/internal.h"
 #include "common.h"
 #include "msg.h"
 #include "vdac.h"
@@ -8,9 +9,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
-#define MIN(a, b) (((a) < (b)) ? (a) : (b))
-#define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define CLAMP(x, lo, hi) (((x) > (hi)) ? (hi) : (((x) < (lo)) ? (lo) : (x)))
 
 #define SIGN16(x)   ((int16_t)(x))
@@ -23,17 +27,6 @@
 
 #define PIXELS_TO_BYTES(pix, siz) (((pix) << (siz)) >> 1)
 
-// RGBA5551 to RGBA8888 helper
-#define RGBA16_R(x) (((x) >> 8) & 0xf8)
-#define RGBA16_G(x) (((x) & 0x7c0) >> 3)
-#define RGBA16_B(x) (((x) & 0x3e) << 2)
-
-// RGBA8888 helper
-#define RGBA32_R(x) (((x) >> 24) & 0xff)
-#define RGBA32_G(x) (((x) >> 16) & 0xff)
-#define RGBA32_B(x) (((x) >> 8) & 0xff)
-#define RGBA32_A(x) ((x) & 0xff)
-
 // maximum number of commands to buffer for parallel processing
 #define CMD_BUFFER_SIZE 1024
 
@@ -88,7 +81,7 @@ static struct n64video_config config;
 
 static struct
 {
-    bool fillmbitcrashes, vbusclock, nolerp;
+    bool fillmbitcrashes;
 } onetimewarnings;
 
 static int rdp_pipeline_crashed = 0;
@@ -103,18 +96,17 @@ static STRICTINLINE int32_t clamp(int32_t value, int32_t min, int32_t max)
         return value;
 }
 
-static STRICTINLINE uint32_t irand(uint32_t* state)
-{
-    *state = *state * 0x343fd + 0x269ec3;
-    return ((*state >> 16) & 0x7fff);
-}
-
 // include guard to prevent compilation of code modules
-// as translation units
+// as translation units. tests and benchmarks that drive the static pipeline
+// stages directly include this file and so build their own copy of the core.
+// they must not link the core library as well, as its exported symbols would
+// clash with theirs. the VI is a translation unit of its own in n64video/vi.c,
+// which they can include as well to reach the VI filters
 #define N64VIDEO_C
 
+#include "n64video/stats.c"
+#include "n64video/trace.c"
 #include "n64video/rdp.c"
-#include "n64video/vi.c"
 
 static uint32_t rdp_cmd_buf[CMD_BUFFER_SIZE][CMD_MAX_INTS];
 static uint32_t rdp_cmd_buf_pos;
@@ -127,23 +119,114 @@ static uint32_t rdp_cmd_len;
 // multithreaded mode
 static bool rdp_cmd_sync[64];
 
+// color and depth image as set by the parsed commands, which may be ahead of
+// the workers in multithreaded mode
+static struct
+{
+    uint32_t fb_address;
+    uint32_t fb_size;
+    uint32_t fb_width;
+    uint32_t zb_address;
+    uint32_t clip_yl;
+} rdp_cmd_images;
+
+// RDRAM area that may be written by the buffered commands
+static uint32_t rdp_cmd_pending_start;
+static uint32_t rdp_cmd_pending_end;
+
 static void cmd_run_buffered(uint32_t worker_id)
 {
+    uint64_t start = config.stats || config.trace ? stats_time() : 0;
+
     uint32_t pos;
     for (pos = 0; pos < rdp_cmd_buf_pos; pos++) {
         rdp_cmd(worker_id, rdp_cmd_buf[pos]);
     }
+
+    if (config.stats) {
+        stats_worker_busy(worker_id, stats_time() - start);
+    }
+
+    if (config.trace) {
+        trace_add(worker_id, "cmd_run_buffered", start);
+    }
 }
 
 static void cmd_flush(void)
 {
     // only run if there's something buffered
     if (rdp_cmd_buf_pos) {
+        uint64_t start = config.stats || config.trace ? stats_time() : 0;
+
         // let workers run all buffered commands in parallel
         parallel_run(cmd_run_buffered);
+
+        if (config.stats) {
+            stats_flush(stats_time() - start, rdp_cmd_buf_pos);
+        }
+
+        if (config.trace) {
+            trace_add(0, "cmd_flush", start);
+        }
         // reset buffer by starting from the beginning
         rdp_cmd_buf_pos = 0;
     }
+
+    rdp_cmd_pending_start = ~0;
+    rdp_cmd_pending_end = 0;
+}
+
+static void cmd_track_images(const uint32_t* cmd)
+{
+    switch (CMD_ID(cmd)) {
+        case CMD_ID_SET_COLOR_IMAGE:
+            rdp_cmd_images.fb_size = (cmd[0] >> 19) & 0x3;
+            rdp_cmd_images.fb_width = (cmd[0] & 0x3ff) + 1;
+            rdp_cmd_images.fb_address = cmd[1] & 0x0ffffff;
+            break;
+
+        case CMD_ID_SET_MASK_IMAGE:
+            rdp_cmd_images.zb_address = cmd[1] & 0x0ffffff;
+            break;
+
+        case CMD_ID_SET_SCISSOR:
+            rdp_cmd_images.clip_yl = cmd[1] & 0xfff;
+            break;
+    }
+}
+
+// number of rows of the images that can be written, which includes the row
+// of the bottom edge of the scissor box
+static uint32_t cmd_images_height(void)
+{
+    return (rdp_cmd_images.clip_yl >> 2) + 1;
+}
+
+static void cmd_track_pending(uint32_t cmd_id)
+{
+    // only primitives write to RDRAM
+    bool primitive = (cmd_id >= CMD_ID_FILL_TRIANGLE && cmd_id <= CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE) ||
+        cmd_id == CMD_ID_TEXTURE_RECTANGLE || cmd_id == CMD_ID_TEXTURE_RECTANGLE_FLIP ||
+        cmd_id == CMD_ID_FILL_RECTANGLE;
+
+    if (!primitive) {
+        return;
+    }
+
+    // without a color image, the primitive may write anywhere
+    if (!rdp_cmd_images.fb_width) {
+        rdp_cmd_pending_start = 0;
+        rdp_cmd_pending_end = ~0;
+        return;
+    }
+
+    // extend the area to both images down to the bottom of the scissor box
+    uint32_t pixels = rdp_cmd_images.fb_width * cmd_images_height();
+    uint32_t fb_end = rdp_cmd_images.fb_address + PIXELS_TO_BYTES(pixels, rdp_cmd_images.fb_size);
+    uint32_t zb_end = rdp_cmd_images.zb_address + pixels * 2;
+
+    rdp_cmd_pending_start = MIN(rdp_cmd_pending_start, MIN(rdp_cmd_images.fb_address, rdp_cmd_images.zb_address));
+    rdp_cmd_pending_end = MAX(rdp_cmd_pending_end, MAX(fb_end, zb_end));
 }
 
 static void cmd_init(void)
@@ -163,6 +246,15 @@ void n64video_config_init(struct n64video_config* config)
     config->dp.compat = DP_COMPAT_MEDIUM;
 }
 
+void rdp_sync_worker(uint32_t worker_id)
+{
+    // copy state from main worker, which is done by each worker itself so its
+    // memory is first touched and allocated on the worker's own NUMA node
+    if (worker_id) {
+        memcpy(&state[worker_id], &state[0], sizeof(struct rdp_state));
+    }
+}
+
 void rdp_init_worker(uint32_t worker_id)
 {
     rdp_init(worker_id, parallel_num_workers());
@@ -205,26 +297,31 @@ void n64video_init(struct n64video_config* _config)
 
     // init internals
     rdram_init();
-    vi_init();
+    vi_init(&config);
     cmd_init();
 
+    memset(&rdp_cmd_images, 0, sizeof(rdp_cmd_images));
+    rdp_cmd_buf_pos = 0;
+    rdp_cmd_pending_start = ~0;
+    rdp_cmd_pending_end = 0;
+
     rdp_pipeline_crashed = 0;
     memset(&onetimewarnings, 0, sizeof(onetimewarnings));
 
     if (config.parallel) {
         // init worker system
-        parallel_init(config.num_workers);
+        parallel_init(config.num_workers, config.affinity);
 
         // sync states from main worker
-        for (uint32_t i = 1; i < parallel_num_workers(); i++) {
-            memcpy(&state[i], &state[0], sizeof(struct rdp_state));
-        }
+        parallel_run(rdp_sync_worker);
 
         // init workers
         parallel_run(rdp_init_worker);
     } else {
         rdp_init(0, 1);
     }
+
+    trace_init();
 }
 
 void n64video_process_list(void)
@@ -238,6 +335,8 @@ void n64video_process_list(void)
         return;
     }
 
+    uint64_t start = config.stats ? stats_time() : 0;
+
     // while there's data in the command buffer...
     while (dp_end_al - dp_current_al > 0) {
         uint32_t i, toload;
@@ -258,7 +357,7 @@ void n64video_process_list(void)
         }
 
         // copy more data from the N64 to the local command buffer
-        toload = MIN(dp_end_al - dp_current_al, rdp_cmd_len - 1);
+        toload = MIN(dp_end_al - dp_current_al, rdp_cmd_len - rdp_cmd_pos);
 
         if (xbus_dma) {
             for (i = 0; i < toload; i++) {
@@ -272,6 +371,8 @@ void n64video_process_list(void)
 
         // if there's enough data for the current command...
         if (rdp_cmd_pos == rdp_cmd_len) {
+            cmd_track_images(cmd_buf);
+
             // check if parallel processing is enabled
             if (config.parallel) {
                 // special case: sync_full always needs to be run in main thread
@@ -279,9 +380,12 @@ void n64video_process_list(void)
                     // first, run all pending commands
                     cmd_flush();
 
-                    // parameters are unused, so NULL is fine
-                    rdp_sync_full(0, NULL);
+                    // run it through the command table so it's counted in
+                    // the statistics like any other command
+                    rdp_cmd(0, cmd_buf);
                 } else {
+                    cmd_track_pending(rdp_cmd_id);
+
                     // increment buffer position
                     rdp_cmd_buf_pos++;
 
@@ -307,10 +411,112 @@ void n64video_process_list(void)
 
     // update DP registers to indicate that all bytes have been read
     *dp_reg[DP_START] = *dp_reg[DP_CURRENT] = *dp_reg[DP_END];
+
+    if (config.stats) {
+        stats_frame.process_list += stats_time() - start;
+    }
+}
+
+// runs the buffered commands if they may write to the given RDRAM area
+static void cmd_flush_range(uint32_t start, uint32_t end)
+{
+    if (start < rdp_cmd_pending_end && end > rdp_cmd_pending_start) {
+        uint32_t pos = rdp_cmd_buf_pos;
+        cmd_flush();
+
+        // keep the command that is still being loaded
+        if (rdp_cmd_pos) {
+            memmove(rdp_cmd_buf[0], rdp_cmd_buf[pos], rdp_cmd_pos * sizeof(uint32_t));
+        }
+    }
+}
+
+void n64video_fb_read(uint32_t addr)
+{
+    // the CPU reads a 4 KiB page, so run the buffered commands first if they
+    // may write to it
+    uint32_t start = addr & 0x0fff000;
+    cmd_flush_range(start, start + 0x1000);
+}
+
+void n64video_fb_write(uint32_t addr, uint32_t size)
+{
+    // lines of the VI that show the written area have to be filtered again
+    rdram_mark_dirty_range(addr & 0x0ffffff, size);
+}
+
+uint32_t n64video_fb_info(struct n64video_fb_info* info, uint32_t count)
+{
+    uint32_t num = 0;
+
+    if (!rdp_cmd_images.fb_width) {
+        return 0;
+    }
+
+    uint32_t height = cmd_images_height();
+
+    if (num < count) {
+        info[num].addr = rdp_cmd_images.fb_address;
+        // a 4 bit image has half a byte per pixel, which is rounded up
+        info[num].size = MAX(PIXELS_TO_BYTES(1, rdp_cmd_images.fb_size), 1);
+        info[num].width = rdp_cmd_images.fb_width;
+        info[num].height = height;
+        num++;
+    }
+
+    if (num < count && rdp_cmd_images.zb_address) {
+        info[num].addr = rdp_cmd_images.zb_address;
+        info[num].size = 2;
+        info[num].width = rdp_cmd_images.fb_width;
+        info[num].height = height;
+        num++;
+    }
+
+    return num;
+}
+
+static uint64_t fb_hash_bytes(uint64_t hash, const uint8_t* data, size_t size)
+{
+    // FNV-1a on whole words with an extra shift so that the high bits of a
+    // word affect the low bits of the hash as well
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; size; size--, data++) {
+        hash = (hash ^ *data) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+uint64_t n64video_fb_hash(uint32_t addr, uint32_t size)
+{
+    uint32_t start = addr & 0x0ffffff;
+    uint32_t end = MIN(start + size, idxlim8 + 1);
+
+    if (start >= end) {
+        return 0;
+    }
+
+    cmd_flush_range(start, end);
+
+    // RDRAM is stored in words, hash all words that overlap the area
+    start &= ~3;
+    end = MIN((end + 3) & ~3, idxlim8 + 1);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fb_hash_bytes(hash, rdram8 + start, end - start);
+    hash = fb_hash_bytes(hash, rdram_hidden + (start >> 1), (end - start) >> 1);
+    return hash;
 }
 
 void n64video_close(void)
 {
     vi_close();
+    trace_close();
     parallel_close();
 }
@@ -63,6 +63,23 @@ enum dp_compat_profile
     DP_COMPAT_NUM
 };
 
+// statistics enums
+enum dp_span_path
+{
+    DP_SPANS_1CYCLE_COMPLETE,       // 1 cycle mode with two texels per pixel
+    DP_SPANS_1CYCLE_NOTEXEL1,       // 1 cycle mode with one texel per pixel
+    DP_SPANS_1CYCLE_NOTEX,          // 1 cycle mode without texture
+    DP_SPANS_2CYCLE_COMPLETE,       // 2 cycle mode with all texels
+    DP_SPANS_2CYCLE_NOTEXELNEXT,    // 2 cycle mode without texel of the next pixel
+    DP_SPANS_2CYCLE_NOTEXEL1,       // 2 cycle mode with one texel per pixel
+    DP_SPANS_2CYCLE_NOTEX,          // 2 cycle mode without texture
+    DP_SPANS_FILL,                  // fill mode
+    DP_SPANS_COPY,                  // copy mode
+    DP_SPANS_NUM
+};
+
+struct frame_buffer;
+
 struct n64video_config
 {
     struct {
@@ -81,16 +98,95 @@ struct n64video_config
         bool hide_overscan;         // crop to visible area if true
         bool vsync;                 // enable vsync if true
         bool exclusive;             // run in exclusive mode when in fullscreen if true
+        bool skip_unchanged;        // skip filtering of frame lines that weren't changed by the RDP if true
+        // the background pass filters on a single thread while the workers
+        // render the next frame, so it is slower than filtering on all
+        // workers if the VI takes longer than the RDP
+        bool pipelined;             // filter frames in the background and present them one frame later if true
     } vi;
+    struct {
+        bool headless;              // pass frames to frame_cb instead of drawing them with OpenGL if true
+        void (*frame_cb)(struct frame_buffer* fb, void* user); // headless frame callback, fb is NULL for blank frames
+        void* frame_cb_user;        // user pointer passed to frame_cb
+        uint32_t ring_size;         // number of buffers headless frames are copied to, 0 to pass them in place
+    } vdac;
     struct {
         enum dp_compat_profile compat;  // multithreading compatibility mode
     } dp;
+    bool stats;                     // collect performance statistics for n64video_get_stats if true
+    bool trace;                     // record timeline events for n64video_trace_dump if true
     bool parallel;                  // use multithreaded renderer if true
     uint32_t num_workers;           // number of rendering workers
+    bool affinity;                  // pin rendering workers to CPUs and NUMA nodes if true
+};
+
+// RDRAM image that is rendered to by the RDP
+struct n64video_fb_info
+{
+    uint32_t addr;                  // RDRAM address
+    uint32_t size;                  // bytes per pixel, 1 for 4 bit images
+    uint32_t width;                 // width in pixels
+    uint32_t height;                // height in pixels
+};
+
+// performance statistics of a command ID
+struct n64video_cmd_stats
+{
+    uint64_t count;                 // number of commands that were run
+    uint64_t time;                  // time spent running them in nanoseconds, summed over all workers
+    uint64_t pixels;                // number of pixels rasterized by them
+};
+
+// throughput of a rasterizer span path
+struct n64video_span_stats
+{
+    uint64_t prims;                 // number of primitives that used it
+    uint64_t spans;                 // number of spans rendered
+    uint64_t pixels;                // number of pixels rendered
+    uint64_t z_rejected;            // pixels rejected by the depth compare
+    uint64_t alpha_rejected;        // pixels rejected by the alpha compare
+    uint64_t cvg_rejected;          // pixels rejected for lack of coverage
+};
+
+struct n64video_stats
+{
+    struct n64video_cmd_stats cmd[64];  // statistics of each command ID
+    struct n64video_span_stats spans[DP_SPANS_NUM]; // statistics of each span path
+};
+
+// timing of a frame, from the end of one n64video_update_screen call to the
+// end of the next one. all times are in nanoseconds
+struct n64video_frame_stats
+{
+    uint64_t process_list;          // wall time spent in n64video_process_list
+    uint64_t wait;                  // time the main thread was blocked waiting for workers
+    uint64_t vi;                    // time spent in the VI filters, excluding vdac_write
+    uint64_t vdac_write;            // time spent in vdac_write
+    uint64_t vdac_sync;             // time spent in vdac_sync
+    uint32_t vi_rows;               // number of output rows filtered by the VI
+    uint32_t flushes;               // number of times buffered commands were run by the workers
+    uint32_t flushed_cmds;          // number of commands run by these flushes
+    uint32_t num_workers;           // number of valid entries in worker_busy and worker_idle
+    uint64_t worker_busy[64];       // time each worker spent running commands
+    uint64_t worker_idle[64];       // time each worker waited for the others during flushes
 };
 
 void n64video_config_init(struct n64video_config* config);
 void n64video_init(struct n64video_config* config);
 void n64video_update_screen(void);
+void n64video_read_screen(struct frame_buffer* fb, bool alpha);
 void n64video_process_list(void);
+void n64video_fb_read(uint32_t addr);
+// called after the CPU has written an RDRAM area, which only marks it dirty
+// for the VI. with the parallel renderer, commands that were buffered before
+// the write still run after it: loads from the area get the new data and draws
+// to it overwrite what the CPU wrote. the plugin APIs only report the write
+// once it happened, so there is no point at which to run them first
+void n64video_fb_write(uint32_t addr, uint32_t size);
+uint32_t n64video_fb_info(struct n64video_fb_info* info, uint32_t count);
+uint64_t n64video_fb_hash(uint32_t addr, uint32_t size);
+void n64video_get_stats(struct n64video_stats* stats);
+void n64video_reset_stats(void);
+void n64video_get_frame_stats(struct n64video_frame_stats* stats);
+bool n64video_trace_dump(const char* path);
 void n64video_close(void);
@@ -0,0 +1,158 @@
+#pragma once
+
+// interface between the translation units of the core, which are n64video.c
+// with the RDP and everything it includes and vi.c with the VI. everything
+// the VI needs per pixel is inlined from here, the calls between the units
+// are only made per line, frame or flush and are inlined with IPO
+
+#include "../n64video.h"
+#include "../common.h"
+#include "../parallel.h"
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// RGBA5551 to RGBA8888 helper
+#define RGBA16_R(x) (((x) >> 8) & 0xf8)
+#define RGBA16_G(x) (((x) & 0x7c0) >> 3)
+#define RGBA16_B(x) (((x) & 0x3e) << 2)
+
+// RGBA8888 helper
+#define RGBA32_R(x) (((x) >> 24) & 0xff)
+#define RGBA32_G(x) (((x) >> 16) & 0xff)
+#define RGBA32_B(x) (((x) >> 8) & 0xff)
+#define RGBA32_A(x) ((x) & 0xff)
+
+static STRICTINLINE uint32_t irand(uint32_t* state)
+{
+    *state = *state * 0x343fd + 0x269ec3;
+    return ((*state >> 16) & 0x7fff);
+}
+
+// fills states with the next count states of irand, using four interleaved
+// generators that each jump four steps ahead to avoid the serial dependency.
+// the array must have room for count rounded up to a multiple of four
+static STRICTINLINE void irand_bulk(uint32_t* state, uint32_t* states, int32_t count)
+{
+    int32_t i, k;
+    uint32_t s[4];
+
+    if (count <= 0) {
+        return;
+    }
+
+    s[0] = *state * 0x343fd + 0x269ec3;
+    for (k = 1; k < 4; k++) {
+        s[k] = s[k - 1] * 0x343fd + 0x269ec3;
+    }
+
+    for (i = 0; i < count; i += 4) {
+        for (k = 0; k < 4; k++) {
+            states[i + k] = s[k];
+            s[k] = s[k] * 0xddff5051 + 0x098520c4;
+        }
+    }
+
+    *state = states[count - 1];
+}
+
+//
+// RDRAM, written by the RDP in rdp/rdram.c and read by both
+//
+
+#define RDRAM_MASK 0x00ffffff
+
+// pointer indexing limits for aliasing RDRAM reads and writes
+extern uint32_t idxlim8;
+extern uint32_t idxlim16;
+extern uint32_t idxlim32;
+
+extern uint32_t* rdram32;
+extern uint16_t* rdram16;
+extern uint8_t* rdram8;
+extern uint8_t rdram_hidden[RDRAM_MAX_SIZE / 2];
+
+bool rdram_test_dirty(uint32_t addr, uint32_t length);
+void rdram_clear_dirty(uint32_t addr, uint32_t length);
+
+static STRICTINLINE bool rdram_valid_idx8(uint32_t in)
+{
+    return in <= idxlim8;
+}
+
+static STRICTINLINE bool rdram_valid_idx16(uint32_t in)
+{
+    return in <= idxlim16;
+}
+
+static STRICTINLINE bool rdram_valid_idx32(uint32_t in)
+{
+    return in <= idxlim32;
+}
+
+static STRICTINLINE uint8_t rdram_read_idx8(uint32_t in)
+{
+    in &= RDRAM_MASK;
+    return rdram_valid_idx8(in) ? rdram8[in ^ BYTE_ADDR_XOR] : 0;
+}
+
+static STRICTINLINE uint8_t rdram_read_idx8_fast(uint32_t in)
+{
+    return rdram8[in ^ BYTE_ADDR_XOR];
+}
+
+static STRICTINLINE uint16_t rdram_read_idx16(uint32_t in)
+{
+    in &= RDRAM_MASK >> 1;
+    return rdram_valid_idx16(in) ? rdram16[in ^ WORD_ADDR_XOR] : 0;
+}
+
+static STRICTINLINE uint16_t rdram_read_idx16_fast(uint32_t in)
+{
+    return rdram16[in ^ WORD_ADDR_XOR];
+}
+
+static STRICTINLINE uint32_t rdram_read_idx32(uint32_t in)
+{
+    in &= RDRAM_MASK >> 2;
+    return rdram_valid_idx32(in) ? rdram32[in] : 0;
+}
+
+static STRICTINLINE uint32_t rdram_read_idx32_fast(uint32_t in)
+{
+    return rdram32[in];
+}
+
+static STRICTINLINE void rdram_read_pair16(uint16_t* rdst, uint8_t* hdst, uint32_t in)
+{
+    in &= RDRAM_MASK >> 1;
+    if (rdram_valid_idx16(in)) {
+        *rdst = rdram16[in ^ WORD_ADDR_XOR];
+        *hdst = rdram_hidden[in];
+    } else {
+        *rdst = *hdst = 0;
+    }
+}
+
+//
+// statistics and tracing, in stats.c and trace.c
+//
+
+// ring of the background thread that runs pipelined VI passes, the main
+// thread uses the ring of worker 0
+#define TRACE_ASYNC PARALLEL_MAX_WORKERS
+
+// timing of the current frame
+extern struct n64video_frame_stats stats_frame;
+
+uint64_t stats_time(void);
+void stats_frame_end(void);
+void trace_add(uint32_t tid, const char* name, uint64_t start);
+
+//
+// VI, in vi.c
+//
+
+void vi_init(struct n64video_config* config);
+void vi_set_zbuffer_address(uint32_t address);
+void vi_close(void);
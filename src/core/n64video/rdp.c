@@ -160,6 +160,7 @@ struct span
     int lx, rx;
     int unscrx;
     int validline;
+    int validscan; // like validline, but regardless of the worker the scanline belongs to
     int32_t r, g, b, a, s, t, w, z;
     int32_t majorx[4];
     int32_t minorx[4];
@@ -315,6 +316,22 @@ struct rdp_state
     uint32_t fb_address;
     uint32_t fill_color;
 
+    // span write buffer, which holds the pixels in the order and format of
+    // RDRAM starting at fbspan_start
+    int fbspan_en;
+    uint32_t fbspan_idx;
+    int32_t fbspan_inc;
+    int32_t fbspan_len;
+    uint32_t fbspan_start;
+    int32_t fbspan_pos;
+    uint32_t fbspan_color[1024];
+    uint16_t fbspan_color16[1026];
+    uint8_t fbspan_hidden[2048];
+    uint8_t fbspan_valid[1025];
+    int fbspan_prefetch;
+    uint32_t fbspan_mem[1024];
+    uint8_t fbspan_memcvg[1024];
+
     // rasterizer
     struct rectangle clip;
     int scfield;
@@ -331,6 +348,8 @@ struct rdp_state
 
     // coverage
     uint8_t cvgbuf[1024];
+    int32_t cvgfull_start;      // fully covered pixel range of the current span,
+    int32_t cvgfull_end;        // which isn't stored in cvgbuf
 
     // tmem
     uint8_t tmem[0x1000];
@@ -593,6 +612,11 @@ void rdp_sync_tile(uint32_t wid, const uint32_t* args)
 
 void rdp_sync_full(uint32_t wid, const uint32_t* args)
 {
+    // all workers are idle here, so collect their statistics
+    if (config.stats) {
+        stats_merge();
+    }
+
     // signal DP interrupt
     *config.gfx.mi_intr_reg |= DP_INTERRUPT;
     config.gfx.mi_intr_cb();
@@ -652,6 +676,15 @@ void rdp_set_other_modes(uint32_t wid, const uint32_t* args)
 void rdp_cmd(uint32_t wid, const uint32_t* args)
 {
     uint32_t cmd_id = CMD_ID(args);
+
+    if (config.stats) {
+        stats_cmd_begin(wid, cmd_id);
+        uint64_t start = stats_time();
+        rdp_commands[cmd_id].handler(wid, args);
+        stats_cmd_end(wid, stats_time() - start);
+        return;
+    }
+
     rdp_commands[cmd_id].handler(wid, args);
 }
 
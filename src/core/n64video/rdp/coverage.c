@@ -29,133 +29,103 @@ static STRICTINLINE uint32_t leftcvghex(uint32_t x, uint32_t fmask)
 
 
 
-static STRICTINLINE void compute_cvg_flip(uint32_t wid, int32_t scanline)
+// computes the coverage masks of all pixels in [purgestart, purgeend], where
+// leftx/rightx are the subpixel edges of the four subscanlines; the fully
+// covered interior is only recorded as a range and left out of cvgbuf
+static STRICTINLINE void compute_cvg(uint32_t wid, int32_t purgestart, int32_t purgeend, const int32_t* leftx, const int32_t* rightx, const int32_t* invalyscan)
 {
-    int32_t purgestart, purgeend;
-    int i, length, fmask, maskshift, fmaskshifted;
-    int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
-
-    purgestart = state[wid].span[scanline].rx;
-    purgeend = state[wid].span[scanline].lx;
-    length = purgeend - purgestart;
-    if (length >= 0)
-    {
-
-
-
+    uint8_t* cvgbuf = state[wid].cvgbuf;
+    int32_t leftint[4], rightint[4];
+    int32_t fullstart, fullend;
+    int i, k, fmask, maskshift, fmaskshifted;
 
+    if (purgeend < purgestart)
+    {
+        state[wid].cvgfull_start = 1;
+        state[wid].cvgfull_end = 0;
+        return;
+    }
 
+    // pixels between both edges on all subscanlines are fully covered
+    fullstart = purgestart;
+    fullend = purgeend;
+    for (i = 0; i < 4; i++)
+    {
+        leftint[i] = leftx[i] >> 3;
+        rightint[i] = rightx[i] >> 3;
 
-        memset(&state[wid].cvgbuf[purgestart], 0xff, length + 1);
-        for(i = 0; i < 4; i++)
+        if (invalyscan[i])
         {
+            fullstart = purgeend + 1;
+            fullend = purgeend;
+        }
+        else
+        {
+            fullstart = MAX(fullstart, leftint[i] + 1);
+            fullend = MIN(fullend, rightint[i] - 1);
+        }
+    }
 
-                fmask = 0xa >> (i & 1);
-
-
-
-
-                maskshift = (i - 2) & 4;
-                fmaskshifted = fmask << maskshift;
-
-                if (!state[wid].span[scanline].invalyscan[i])
-                {
-                   int k;
-                    minorcur = state[wid].span[scanline].minorx[i];
-                    majorcur = state[wid].span[scanline].majorx[i];
-                    minorcurint = minorcur >> 3;
-                    majorcurint = majorcur >> 3;
-
-
-                    for (k = purgestart; k <= majorcurint; k++)
-                        state[wid].cvgbuf[k] &= ~fmaskshifted;
-                    for (k = minorcurint; k <= purgeend; k++)
-                        state[wid].cvgbuf[k] &= ~fmaskshifted;
-
-
-
+    // clear everything except the interior
+    if (fullstart <= fullend)
+    {
+        memset(&cvgbuf[purgestart], 0, fullstart - purgestart);
+        memset(&cvgbuf[fullend + 1], 0, purgeend - fullend);
+    }
+    else
+    {
+        memset(&cvgbuf[purgestart], 0, purgeend - purgestart + 1);
+        fullstart = purgeend + 1;
+        fullend = purgeend;
+    }
 
+    state[wid].cvgfull_start = fullstart;
+    state[wid].cvgfull_end = fullend;
 
+    // only the partially covered pixels near the edges remain
+    for (i = 0; i < 4; i++)
+    {
+        int32_t coverstart, coverend;
 
+        if (invalyscan[i])
+            continue;
 
+        fmask = 0xa >> (i & 1);
+        maskshift = (i - 2) & 4;
+        fmaskshifted = fmask << maskshift;
 
+        coverstart = MAX(purgestart, leftint[i] + 1);
+        coverend = MIN(purgeend, rightint[i] - 1);
 
-                    if (minorcurint > majorcurint)
-                    {
-                        state[wid].cvgbuf[minorcurint] |= (rightcvghex(minorcur, fmask) << maskshift);
-                        state[wid].cvgbuf[majorcurint] |= (leftcvghex(majorcur, fmask) << maskshift);
-                    }
-                    else if (minorcurint == majorcurint)
-                    {
-                        samecvg = rightcvghex(minorcur, fmask) & leftcvghex(majorcur, fmask);
-                        state[wid].cvgbuf[majorcurint] |= (samecvg << maskshift);
-                    }
-                }
-                else
-                {
-                    int k;
-                    for (k = purgestart; k <= purgeend; k++)
-                        state[wid].cvgbuf[k] &= ~fmaskshifted;
-                }
+        for (k = coverstart; k <= coverend && k < fullstart; k++)
+            cvgbuf[k] |= fmaskshifted;
+        for (k = MAX(coverstart, fullend + 1); k <= coverend; k++)
+            cvgbuf[k] |= fmaskshifted;
 
+        if (rightint[i] > leftint[i])
+        {
+            if (leftint[i] >= purgestart && leftint[i] <= purgeend)
+                cvgbuf[leftint[i]] |= (leftcvghex(leftx[i], fmask) << maskshift);
+            if (rightint[i] >= purgestart && rightint[i] <= purgeend)
+                cvgbuf[rightint[i]] |= (rightcvghex(rightx[i], fmask) << maskshift);
+        }
+        else if (rightint[i] == leftint[i] && leftint[i] >= purgestart && leftint[i] <= purgeend)
+        {
+            cvgbuf[leftint[i]] |= ((leftcvghex(leftx[i], fmask) & rightcvghex(rightx[i], fmask)) << maskshift);
         }
     }
+}
 
-
+static STRICTINLINE void compute_cvg_flip(uint32_t wid, int32_t scanline)
+{
+    struct span* span = &state[wid].span[scanline];
+    compute_cvg(wid, span->rx, span->lx, span->majorx, span->minorx, span->invalyscan);
 }
 
 static STRICTINLINE void compute_cvg_noflip(uint32_t wid, int32_t scanline)
 {
-    int32_t purgestart, purgeend;
-    int i, length, fmask, maskshift, fmaskshifted;
-    int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
-
-    purgestart = state[wid].span[scanline].lx;
-    purgeend = state[wid].span[scanline].rx;
-    length = purgeend - purgestart;
-
-    if (length >= 0)
-    {
-        memset(&state[wid].cvgbuf[purgestart], 0xff, length + 1);
-
-        for(i = 0; i < 4; i++)
-        {
-            fmask = 0xa >> (i & 1);
-            maskshift = (i - 2) & 4;
-            fmaskshifted = fmask << maskshift;
-
-            if (!state[wid].span[scanline].invalyscan[i])
-            {
-               int k;
-                minorcur = state[wid].span[scanline].minorx[i];
-                majorcur = state[wid].span[scanline].majorx[i];
-                minorcurint = minorcur >> 3;
-                majorcurint = majorcur >> 3;
-
-                for (k = purgestart; k <= minorcurint; k++)
-                    state[wid].cvgbuf[k] &= ~fmaskshifted;
-                for (k = majorcurint; k <= purgeend; k++)
-                    state[wid].cvgbuf[k] &= ~fmaskshifted;
-
-                if (majorcurint > minorcurint)
-                {
-                    state[wid].cvgbuf[minorcurint] |= (leftcvghex(minorcur, fmask) << maskshift);
-                    state[wid].cvgbuf[majorcurint] |= (rightcvghex(majorcur, fmask) << maskshift);
-                }
-                else if (minorcurint == majorcurint)
-                {
-                    samecvg = leftcvghex(minorcur, fmask) & rightcvghex(majorcur, fmask);
-                    state[wid].cvgbuf[majorcurint] |= (samecvg << maskshift);
-                }
-            }
-            else
-            {
-                int k;
-                for (k = purgestart; k <= purgeend; k++)
-                    state[wid].cvgbuf[k] &= ~fmaskshifted;
-            }
-        }
-    }
+    struct span* span = &state[wid].span[scanline];
+    compute_cvg(wid, span->lx, span->rx, span->minorx, span->majorx, span->invalyscan);
 }
 
 static STRICTINLINE int finalize_spanalpha(int cvg_dest, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
@@ -214,6 +184,23 @@ static STRICTINLINE void lookup_cvmask_derivatives(uint8_t mask, uint8_t* offx,
     *offy = cvarray[mask].yoff;
 }
 
+// same as lookup_cvmask_derivatives for pixel x of the current span, but
+// without touching cvgbuf or the lookup table for fully covered pixels
+static STRICTINLINE void lookup_cvmask_span(uint32_t wid, int x, uint8_t* offx, uint8_t* offy, uint32_t* curpixel_cvg, uint32_t* curpixel_cvbit)
+{
+    if (x >= state[wid].cvgfull_start && x <= state[wid].cvgfull_end)
+    {
+        *curpixel_cvg = 8;
+        *curpixel_cvbit = 1;
+        *offx = 0;
+        *offy = 0;
+    }
+    else
+    {
+        lookup_cvmask_derivatives(state[wid].cvgbuf[x], offx, offy, curpixel_cvg, curpixel_cvbit);
+    }
+}
+
 static void coverage_init_lut(void)
 {
     int i = 0, k = 0;
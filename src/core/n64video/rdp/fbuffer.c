@@ -40,7 +40,7 @@ static void fbwrite_8(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g, u
     PAIRWRITE8(fb, r & 0xff, (r & 1) ? 3 : 0);
 }
 
-static void fbwrite_16(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+static STRICTINLINE void fbpack_16(uint32_t wid, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, uint16_t* rval, uint8_t* hval)
 {
 #undef CVG_DRAW
 #ifdef CVG_DRAW
@@ -48,11 +48,6 @@ static void fbwrite_16(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g,
     r=covdraw; g=covdraw; b=covdraw;
 #endif
 
-    uint32_t fb;
-    uint16_t rval;
-    uint8_t hval;
-    fb = (state[wid].fb_address >> 1) + curpixel;
-
     int32_t finalcvg = finalize_spanalpha(state[wid].other_modes.cvg_dest, blend_en, curpixel_cvg, curpixel_memcvg);
     int16_t finalcolor;
 
@@ -67,22 +62,325 @@ static void fbwrite_16(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g,
     }
 
 
-    rval = finalcolor|(finalcvg >> 2);
-    hval = finalcvg & 3;
-    PAIRWRITE16(fb, rval, hval);
+    *rval = finalcolor|(finalcvg >> 2);
+    *hval = finalcvg & 3;
 }
 
-static void fbwrite_32(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+static STRICTINLINE void fbpack_32(uint32_t wid, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, uint32_t* rval, uint8_t* hval)
 {
-    uint32_t fb = (state[wid].fb_address >> 2) + curpixel;
-
     int32_t finalcolor;
     int32_t finalcvg = finalize_spanalpha(state[wid].other_modes.cvg_dest, blend_en, curpixel_cvg, curpixel_memcvg);
 
     finalcolor = (r << 24) | (g << 16) | (b << 8);
     finalcolor |= (finalcvg << 5);
 
-    PAIRWRITE32(fb, finalcolor, (g & 1) ? 3 : 0, 0);
+    *rval = finalcolor;
+    *hval = (g & 1) ? 3 : 0;
+}
+
+static void fbwrite_16(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+{
+    uint32_t fb;
+    uint16_t rval;
+    uint8_t hval;
+    fb = (state[wid].fb_address >> 1) + curpixel;
+
+    fbpack_16(wid, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, &rval, &hval);
+    PAIRWRITE16(fb, rval, hval);
+}
+
+static void fbwrite_32(uint32_t wid, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+{
+    uint32_t fb = (state[wid].fb_address >> 2) + curpixel;
+    uint32_t rval;
+    uint8_t hval;
+
+    fbpack_32(wid, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, &rval, &hval);
+    PAIRWRITE32(fb, rval, hval, 0);
+}
+
+// reads all pixels of the span with image_read_en set, packed as memory_color
+// and coverage, so the span renderers don't need to access RDRAM per pixel
+static STRICTINLINE void fbspan_prefetch(uint32_t wid)
+{
+    int j;
+    uint32_t idx, last;
+    uint32_t mem;
+    uint16_t fword;
+    uint8_t hbyte, lowbits;
+    bool valid;
+
+    last = state[wid].fbspan_idx;
+    if (state[wid].fbspan_inc > 0)
+        last += state[wid].fbspan_len - 1;
+
+    if (state[wid].fb_size == PIXEL_SIZE_16BIT)
+    {
+        valid = rdram_valid_idx16(last);
+        for (j = 0, idx = state[wid].fbspan_idx; j < state[wid].fbspan_len; j++, idx += state[wid].fbspan_inc)
+        {
+            if (valid)
+            {
+                fword = rdram16[idx ^ WORD_ADDR_XOR];
+                hbyte = rdram_hidden[idx];
+            }
+            else
+            {
+                PAIRREAD16(fword, hbyte, idx);
+            }
+
+            if (state[wid].fb_format == FORMAT_RGBA)
+            {
+                lowbits = ((fword & 1) << 2) | hbyte;
+                mem = (RGBA16_R(fword) << 24) | (RGBA16_G(fword) << 16) | (RGBA16_B(fword) << 8);
+            }
+            else
+            {
+                lowbits = (fword >> 5) & 7;
+                mem = (fword >> 8) * 0x01010100;
+            }
+
+            state[wid].fbspan_mem[j] = mem | (lowbits << 5);
+            state[wid].fbspan_memcvg[j] = lowbits;
+        }
+    }
+    else
+    {
+        valid = rdram_valid_idx32(last);
+        for (j = 0, idx = state[wid].fbspan_idx; j < state[wid].fbspan_len; j++, idx += state[wid].fbspan_inc)
+        {
+            if (valid)
+                mem = rdram32[idx];
+            else
+                RREADIDX32(mem, idx);
+
+            state[wid].fbspan_mem[j] = (mem & ~0xff) | (mem & 0xe0);
+            state[wid].fbspan_memcvg[j] = (mem >> 5) & 7;
+        }
+    }
+}
+
+// 16 and 32 bit pixels of a span are collected in a per-worker buffer and
+// written to RDRAM in one go at the end of the span. This is only possible
+// if nothing else in the span touches the memory of the buffered pixels, so
+// the buffer is bypassed if the Z-buffer overlaps the span's color pixels.
+// The buffer starts at the lowest address of the span, at a whole word for
+// 16 bit pixels, so runs of written pixels can be copied to RDRAM as they
+// are, also for spans that are rendered from right to left.
+static STRICTINLINE void fbspan_begin(uint32_t wid, uint32_t curpixel, int length, int xinc)
+{
+    uint32_t first, last, shift, idxmask;
+    uint32_t fbstart, fbend, zbstart, zbend;
+
+    state[wid].fbspan_en = 0;
+    state[wid].fbspan_prefetch = 0;
+
+    if (length < 0 || length >= 1024)
+        return;
+
+    switch (state[wid].fb_size)
+    {
+    case PIXEL_SIZE_16BIT:
+        shift = 1;
+        break;
+    case PIXEL_SIZE_32BIT:
+        shift = 2;
+        break;
+    default:
+        return;
+    }
+
+    first = curpixel;
+    last = curpixel + xinc * length;
+    if (xinc < 0)
+    {
+        first = last;
+        last = curpixel;
+    }
+
+    // don't bother with spans that wrap around the address space
+    idxmask = RDRAM_MASK >> shift;
+    fbstart = (state[wid].fb_address >> shift) + first;
+    fbend = (state[wid].fb_address >> shift) + last;
+    if (fbend > idxmask || fbstart > fbend)
+        return;
+
+    if (state[wid].other_modes.z_compare_en || state[wid].other_modes.z_update_en)
+    {
+        zbstart = (state[wid].zb_address >> 1) + first;
+        zbend = (state[wid].zb_address >> 1) + last;
+        if (zbend > (RDRAM_MASK >> 1) || zbstart > zbend)
+            return;
+
+        // compare byte ranges
+        if ((zbstart << 1) <= ((fbend + 1) << shift) - 1 && (fbstart << shift) <= (zbend << 1) + 1)
+            return;
+    }
+
+    state[wid].fbspan_en = 1;
+    state[wid].fbspan_idx = (state[wid].fb_address >> shift) + curpixel;
+    state[wid].fbspan_inc = xinc;
+    state[wid].fbspan_len = length + 1;
+    state[wid].fbspan_start = shift == 1 ? fbstart & ~1 : fbstart;
+    state[wid].fbspan_pos = state[wid].fbspan_idx - state[wid].fbspan_start;
+    memset(state[wid].fbspan_valid, 0, fbend - state[wid].fbspan_start + 1);
+
+    // the same conditions apply for reading the span ahead of time
+    if (state[wid].other_modes.image_read_en)
+    {
+        state[wid].fbspan_prefetch = 1;
+        fbspan_prefetch(wid);
+    }
+}
+
+static STRICTINLINE void fbspan_read(uint32_t wid, int j, uint32_t curpixel, uint32_t* curpixel_memcvg)
+{
+    if (state[wid].fbspan_prefetch)
+    {
+        uint32_t mem = state[wid].fbspan_mem[j];
+        state[wid].memory_color.r = RGBA32_R(mem);
+        state[wid].memory_color.g = RGBA32_G(mem);
+        state[wid].memory_color.b = RGBA32_B(mem);
+        state[wid].memory_color.a = RGBA32_A(mem);
+        *curpixel_memcvg = state[wid].fbspan_memcvg[j];
+    }
+    else
+    {
+        state[wid].fbread1_ptr(wid, curpixel, curpixel_memcvg);
+    }
+}
+
+static STRICTINLINE void fbspan_read2(uint32_t wid, int j, uint32_t curpixel, uint32_t* curpixel_memcvg)
+{
+    if (state[wid].fbspan_prefetch)
+    {
+        uint32_t mem = state[wid].fbspan_mem[j];
+        state[wid].pre_memory_color.r = RGBA32_R(mem);
+        state[wid].pre_memory_color.g = RGBA32_G(mem);
+        state[wid].pre_memory_color.b = RGBA32_B(mem);
+        state[wid].pre_memory_color.a = RGBA32_A(mem);
+        *curpixel_memcvg = state[wid].fbspan_memcvg[j];
+    }
+    else
+    {
+        state[wid].fbread2_ptr(wid, curpixel, curpixel_memcvg);
+    }
+}
+
+static STRICTINLINE void fbspan_write(uint32_t wid, int j, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+{
+    if (!state[wid].fbspan_en)
+    {
+        state[wid].fbwrite_ptr(wid, curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg);
+        return;
+    }
+
+    int k = state[wid].fbspan_pos + state[wid].fbspan_inc * j;
+
+    if (state[wid].fb_size == PIXEL_SIZE_16BIT)
+    {
+        fbpack_16(wid, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, &state[wid].fbspan_color16[k ^ WORD_ADDR_XOR], &state[wid].fbspan_hidden[k]);
+    }
+    else
+    {
+        fbpack_32(wid, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, &state[wid].fbspan_color[k], &state[wid].fbspan_hidden[k << 1]);
+        state[wid].fbspan_hidden[(k << 1) + 1] = 0;
+    }
+
+    state[wid].fbspan_valid[k] = 1;
+}
+
+// copies the buffered pixels from k to end - 1 to RDRAM
+static STRICTINLINE void fbspan_copy16(uint32_t wid, int k, int end)
+{
+    uint32_t start = state[wid].fbspan_start;
+
+    memcpy(&rdram_hidden[start + k], &state[wid].fbspan_hidden[k], end - k);
+
+    // the halfwords of a word are swapped in the buffer as in RDRAM, so only
+    // the words that are written completely can be copied
+    if (WORD_ADDR_XOR)
+    {
+        if (k & 1)
+        {
+            rdram16[(start + k) ^ WORD_ADDR_XOR] = state[wid].fbspan_color16[k ^ WORD_ADDR_XOR];
+            k++;
+        }
+
+        if (end & 1 && k < end)
+        {
+            end--;
+            rdram16[(start + end) ^ WORD_ADDR_XOR] = state[wid].fbspan_color16[end ^ WORD_ADDR_XOR];
+        }
+    }
+
+    memcpy(&rdram16[start + k], &state[wid].fbspan_color16[k], (end - k) * sizeof(uint16_t));
+}
+
+static STRICTINLINE void fbspan_copy32(uint32_t wid, int k, int end)
+{
+    uint32_t start = state[wid].fbspan_start;
+
+    memcpy(&rdram32[start + k], &state[wid].fbspan_color[k], (end - k) * sizeof(uint32_t));
+    memcpy(&rdram_hidden[(start + k) << 1], &state[wid].fbspan_hidden[k << 1], (end - k) << 1);
+}
+
+static STRICTINLINE void fbspan_end(uint32_t wid)
+{
+    int k, end, num;
+    uint32_t start, last;
+    const uint8_t* valid = state[wid].fbspan_valid;
+
+    if (!state[wid].fbspan_en)
+        return;
+
+    state[wid].fbspan_en = 0;
+
+    // the span doesn't wrap, so checking the highest index is enough to
+    // write all pixels directly if they are within RDRAM
+    last = state[wid].fbspan_idx;
+    if (state[wid].fbspan_inc > 0)
+        last += state[wid].fbspan_len - 1;
+
+    start = state[wid].fbspan_start;
+    num = last - start + 1;
+
+    if (state[wid].fb_size == PIXEL_SIZE_16BIT ? !rdram_valid_idx16(last) : !rdram_valid_idx32(last))
+    {
+        for (k = 0; k < num; k++)
+        {
+            if (!valid[k])
+                continue;
+
+            if (state[wid].fb_size == PIXEL_SIZE_16BIT)
+                PAIRWRITE16(start + k, state[wid].fbspan_color16[k ^ WORD_ADDR_XOR], state[wid].fbspan_hidden[k]);
+            else
+                PAIRWRITE32(start + k, state[wid].fbspan_color[k], state[wid].fbspan_hidden[k << 1], 0);
+        }
+        return;
+    }
+
+    // copy each run of written pixels at once
+    for (k = 0; k < num; k = end)
+    {
+        const uint8_t* next = memchr(valid + k, 1, num - k);
+        if (!next)
+            break;
+
+        k = (int)(next - valid);
+        next = memchr(valid + k, 0, num - k);
+        end = next ? (int)(next - valid) : num;
+
+        if (state[wid].fb_size == PIXEL_SIZE_16BIT)
+            fbspan_copy16(wid, k, end);
+        else
+            fbspan_copy32(wid, k, end);
+    }
+
+    if (state[wid].fb_size == PIXEL_SIZE_16BIT)
+        rdram_mark_dirty_range((last + 1 - state[wid].fbspan_len) << 1, state[wid].fbspan_len << 1);
+    else
+        rdram_mark_dirty_range((last + 1 - state[wid].fbspan_len) << 2, state[wid].fbspan_len << 2);
 }
 
 static void fbfill_4(uint32_t wid, uint32_t curpixel)
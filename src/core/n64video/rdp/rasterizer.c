@@ -202,6 +202,7 @@ static void render_spans_1cycle_complete(uint32_t wid, int start, int end, int t
     int news, newt;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc, dsinc, dtinc, dwinc;
     int xinc;
@@ -285,6 +286,8 @@ static void render_spans_1cycle_complete(uint32_t wid, int start, int end, int t
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
 
 
         if (scdiff)
@@ -323,7 +326,7 @@ static void render_spans_1cycle_complete(uint32_t wid, int start, int end, int t
             sigs.endspan = (j == length);
             sigs.preendspan = (j == (length - 1));
 
-            lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
 
             get_texel1_1cycle(wid, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
@@ -368,16 +371,22 @@ static void render_spans_1cycle_complete(uint32_t wid, int start, int end, int t
 
             combiner_1cycle(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread1_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read(wid, j, curpixel, &curpixel_memcvg);
             if (z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
                 if (blender_1cycle(wid, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else if (state[wid].other_modes.antialias_en ? curpixel_cvg : curpixel_cvbit)
+                    alpha_rejected++;
+                else
+                    cvg_rejected++;
             }
+            else
+                z_rejected++;
 
 
 
@@ -392,8 +401,13 @@ static void render_spans_1cycle_complete(uint32_t wid, int start, int end, int t
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -411,6 +425,7 @@ static void render_spans_1cycle_notexel1(uint32_t wid, int start, int end, int t
     int tile1 = tilenum;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc, dsinc, dtinc, dwinc;
     int xinc;
@@ -492,6 +507,8 @@ static void render_spans_1cycle_notexel1(uint32_t wid, int start, int end, int t
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -526,7 +543,7 @@ static void render_spans_1cycle_notexel1(uint32_t wid, int start, int end, int t
             sigs.endspan = (j == length);
             sigs.preendspan = (j == (length - 1));
 
-            lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
             state[wid].tcdiv_ptr(ss, st, sw, &sss, &sst);
 
@@ -542,16 +559,22 @@ static void render_spans_1cycle_notexel1(uint32_t wid, int start, int end, int t
 
             combiner_1cycle(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread1_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read(wid, j, curpixel, &curpixel_memcvg);
             if (z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
                 if (blender_1cycle(wid, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else if (state[wid].other_modes.antialias_en ? curpixel_cvg : curpixel_cvbit)
+                    alpha_rejected++;
+                else
+                    cvg_rejected++;
             }
+            else
+                z_rejected++;
 
             s += dsinc;
             t += dtinc;
@@ -566,8 +589,13 @@ static void render_spans_1cycle_notexel1(uint32_t wid, int start, int end, int t
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -581,6 +609,7 @@ static void render_spans_1cycle_notex(uint32_t wid, int start, int end, int tile
     uint32_t curpixel_cvg, curpixel_cvbit, curpixel_memcvg;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc;
     int xinc;
@@ -653,6 +682,8 @@ static void render_spans_1cycle_notex(uint32_t wid, int start, int end, int tile
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -671,7 +702,7 @@ static void render_spans_1cycle_notex(uint32_t wid, int start, int end, int tile
             sa = a >> 14;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(wid, offx, offy, sr, sg, sb, sa, curpixel_cvg);
             z_correct(wid, offx, offy, &sz, curpixel_cvg);
@@ -681,16 +712,22 @@ static void render_spans_1cycle_notex(uint32_t wid, int start, int end, int tile
 
             combiner_1cycle(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread1_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read(wid, j, curpixel, &curpixel_memcvg);
             if (z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
                 if (blender_1cycle(wid, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else if (state[wid].other_modes.antialias_en ? curpixel_cvg : curpixel_cvbit)
+                    alpha_rejected++;
+                else
+                    cvg_rejected++;
             }
+            else
+                z_rejected++;
             r += drinc;
             g += dginc;
             b += dbinc;
@@ -701,8 +738,13 @@ static void render_spans_1cycle_notex(uint32_t wid, int start, int end, int tile
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int tilenum, int flip)
@@ -726,6 +768,7 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
     int tile3 = tilenum;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc, dsinc, dtinc, dwinc;
     int xinc;
@@ -810,6 +853,8 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
 
 
 
@@ -853,7 +898,7 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
                 texture_pipeline_cycle(wid, &state[wid].texel0_color, &state[wid].texel0_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(wid, &state[wid].texel1_color, &state[wid].texel0_color, sss, sst, tile2, 1);
 
-                lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+                lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
                 rgba_correct(wid, offx, offy, sr, sg, sb, sa, curpixel_cvg);
 
@@ -875,7 +920,7 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
 
             state[wid].tcdiv_ptr(ss, st, sw, &sss, &sst);
 
-            if (j < length || !state[wid].span[i + 1].validline || lodlength < 3)
+            if (j < length || !state[wid].span[i + 1].validscan || lodlength < 3)
             {
                 tclod_2cycle(wid, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &prelodfrac);
 
@@ -901,15 +946,22 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
 
             combiner_2cycle_cycle1(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread2_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read2(wid, j, curpixel, &curpixel_memcvg);
 
 
             wen = z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
 
             if (wen)
+            {
                 wen &= blender_2cycle_cycle0(wid, curpixel_cvg, curpixel_cvbit);
+                if (!wen)
+                    cvg_rejected++;
+            }
             else
+            {
                 state[wid].memory_color = state[wid].pre_memory_color;
+                z_rejected++;
+            }
 
 
 
@@ -931,7 +983,10 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
 
 
 
-            lookup_cvmask_derivatives(j < length ? state[wid].cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            if (j < length)
+                lookup_cvmask_span(wid, x, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            else
+                lookup_cvmask_derivatives(0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(wid, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
@@ -952,10 +1007,12 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
                 if (wen)
                 {
                     blender_2cycle_cycle1(wid, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else
+                    alpha_rejected++;
             }
 
             if (state[wid].other_modes.f.getditherlevel < 2)
@@ -973,8 +1030,13 @@ static void render_spans_2cycle_complete(uint32_t wid, int start, int end, int t
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -995,6 +1057,7 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
     int prim_tile = tilenum;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc, dsinc, dtinc, dwinc;
     int xinc;
@@ -1079,6 +1142,8 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1113,7 +1178,7 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
                 texture_pipeline_cycle(wid, &state[wid].texel0_color, &state[wid].texel0_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(wid, &state[wid].texel1_color, &state[wid].texel0_color, sss, sst, tile2, 1);
 
-                lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+                lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
                 rgba_correct(wid, offx, offy, sr, sg, sb, sa, curpixel_cvg);
 
@@ -1127,14 +1192,21 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
 
             combiner_2cycle_cycle1(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread2_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read2(wid, j, curpixel, &curpixel_memcvg);
 
             wen = z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
 
             if (wen)
+            {
                 wen &= blender_2cycle_cycle0(wid, curpixel_cvg, curpixel_cvbit);
+                if (!wen)
+                    cvg_rejected++;
+            }
             else
+            {
                 state[wid].memory_color = state[wid].pre_memory_color;
+                z_rejected++;
+            }
 
             x += xinc;
 
@@ -1154,7 +1226,10 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
             st = t >> 16;
             sw = w >> 16;
 
-            lookup_cvmask_derivatives(j < length ? state[wid].cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            if (j < length)
+                lookup_cvmask_span(wid, x, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            else
+                lookup_cvmask_derivatives(0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(wid, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
@@ -1174,10 +1249,12 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
                 if (wen)
                 {
                     blender_2cycle_cycle1(wid, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else
+                    alpha_rejected++;
             }
 
             if (state[wid].other_modes.f.getditherlevel < 2)
@@ -1190,8 +1267,13 @@ static void render_spans_2cycle_notexelnext(uint32_t wid, int start, int end, in
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -1210,6 +1292,7 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
     int prim_tile = tilenum;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc, dsinc, dtinc, dwinc;
     int xinc;
@@ -1294,6 +1377,8 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1327,7 +1412,7 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
 
                 texture_pipeline_cycle(wid, &state[wid].texel0_color, &state[wid].texel0_color, sss, sst, tile1, 0);
 
-                lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+                lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
                 rgba_correct(wid, offx, offy, sr, sg, sb, sa, curpixel_cvg);
 
@@ -1341,14 +1426,21 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
 
             combiner_2cycle_cycle1(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread2_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read2(wid, j, curpixel, &curpixel_memcvg);
 
             wen = z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
 
             if (wen)
+            {
                 wen &= blender_2cycle_cycle0(wid, curpixel_cvg, curpixel_cvbit);
+                if (!wen)
+                    cvg_rejected++;
+            }
             else
+            {
                 state[wid].memory_color = state[wid].pre_memory_color;
+                z_rejected++;
+            }
 
             x += xinc;
 
@@ -1368,7 +1460,10 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
             st = t >> 16;
             sw = w >> 16;
 
-            lookup_cvmask_derivatives(j < length ? state[wid].cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            if (j < length)
+                lookup_cvmask_span(wid, x, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            else
+                lookup_cvmask_derivatives(0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(wid, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
@@ -1387,10 +1482,12 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
                 if (wen)
                 {
                     blender_2cycle_cycle1(wid, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else
+                    alpha_rejected++;
             }
 
             if (state[wid].other_modes.f.getditherlevel < 2)
@@ -1403,8 +1500,13 @@ static void render_spans_2cycle_notexel1(uint32_t wid, int start, int end, int t
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -1420,6 +1522,7 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
     uint32_t acalpha;
 
     int i, j;
+    uint32_t z_rejected = 0, alpha_rejected = 0, cvg_rejected = 0;
 
     int drinc, dginc, dbinc, dainc, dzinc;
     int xinc;
@@ -1494,6 +1597,8 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
             compute_cvg_flip(wid, i);
         }
 
+        fbspan_begin(wid, curpixel, length, xinc);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1515,7 +1620,7 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
                 sb = b >> 14;
                 sa = a >> 14;
 
-                lookup_cvmask_derivatives(state[wid].cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+                lookup_cvmask_span(wid, x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
                 rgba_correct(wid, offx, offy, sr, sg, sb, sa, curpixel_cvg);
 
@@ -1529,14 +1634,21 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
 
             combiner_2cycle_cycle1(wid, adith, &curpixel_cvg);
 
-            state[wid].fbread2_ptr(wid, curpixel, &curpixel_memcvg);
+            fbspan_read2(wid, j, curpixel, &curpixel_memcvg);
 
             wen = z_compare(wid, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
 
             if (wen)
+            {
                 wen &= blender_2cycle_cycle0(wid, curpixel_cvg, curpixel_cvbit);
+                if (!wen)
+                    cvg_rejected++;
+            }
             else
+            {
                 state[wid].memory_color = state[wid].pre_memory_color;
+                z_rejected++;
+            }
 
             x += xinc;
 
@@ -1550,7 +1662,10 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
             sb = b >> 14;
             sa = a >> 14;
 
-            lookup_cvmask_derivatives(j < length ? state[wid].cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            if (j < length)
+                lookup_cvmask_span(wid, x, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
+            else
+                lookup_cvmask_derivatives(0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(wid, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
@@ -1563,10 +1678,12 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
                 if (wen)
                 {
                     blender_2cycle_cycle1(wid, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    state[wid].fbwrite_ptr(wid, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    fbspan_write(wid, j, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
                     if (state[wid].other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
+                else
+                    alpha_rejected++;
             }
 
             if (state[wid].other_modes.f.getditherlevel < 2)
@@ -1579,8 +1696,13 @@ static void render_spans_2cycle_notex(uint32_t wid, int start, int end, int tile
             curpixel += xinc;
             zbcur += xinc;
         }
+
+        fbspan_end(wid);
         }
     }
+
+    if (config.stats)
+        stats_add_rejects(wid, z_rejected, alpha_rejected, cvg_rejected);
 }
 
 
@@ -1823,6 +1945,51 @@ static void render_spans_copy(uint32_t wid, int start, int end, int tilenum, int
     }
 }
 
+static enum dp_span_path span_path(uint32_t wid)
+{
+    switch(state[wid].other_modes.cycle_type)
+    {
+        case CYCLE_TYPE_1:
+            switch (state[wid].other_modes.f.textureuselevel0)
+            {
+                case 0: return DP_SPANS_1CYCLE_COMPLETE;
+                case 1: return DP_SPANS_1CYCLE_NOTEXEL1;
+                case 2: default: return DP_SPANS_1CYCLE_NOTEX;
+            }
+        case CYCLE_TYPE_2:
+            switch (state[wid].other_modes.f.textureuselevel1)
+            {
+                case 0: return DP_SPANS_2CYCLE_COMPLETE;
+                case 1: return DP_SPANS_2CYCLE_NOTEXELNEXT;
+                case 2: return DP_SPANS_2CYCLE_NOTEXEL1;
+                case 3: default: return DP_SPANS_2CYCLE_NOTEX;
+            }
+        case CYCLE_TYPE_COPY: return DP_SPANS_COPY;
+        default: return DP_SPANS_FILL;
+    }
+}
+
+static void count_spans(uint32_t wid, int start, int end, int flip)
+{
+    uint64_t spans = 0, pixels = 0;
+    int i;
+
+    for (i = start; i <= end; i++)
+    {
+        if (state[wid].span[i].validline)
+        {
+            int length = flip ? state[wid].span[i].lx - state[wid].span[i].rx : state[wid].span[i].rx - state[wid].span[i].lx;
+            if (length >= 0)
+            {
+                spans++;
+                pixels += length + 1;
+            }
+        }
+    }
+
+    stats_add_spans(wid, span_path(wid), spans, pixels);
+}
+
 static void edgewalker_for_prims(uint32_t wid, int32_t* ewdata)
 {
     int j = 0;
@@ -2074,7 +2241,7 @@ static void edgewalker_for_prims(uint32_t wid, int32_t* ewdata)
     if ((yl >> 2) > (ylfar >> 2))
         ylfar += 4;
     else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023)
-        state[wid].span[(yllimit >> 2) + 1].validline = 0;
+        state[wid].span[(yllimit >> 2) + 1].validline = state[wid].span[(yllimit >> 2) + 1].validscan = 0;
 
 
     if (yh & 0x2000)
@@ -2176,7 +2343,8 @@ static void edgewalker_for_prims(uint32_t wid, int32_t* ewdata)
             {
                 state[wid].span[j].lx = maxxmx;
                 state[wid].span[j].rx = minxhx;
-                state[wid].span[j].validline  = !allinval && !allover && !allunder && (!state[wid].scfield || (state[wid].scfield && !(state[wid].sckeepodd ^ (j & 1)))) && (!state[wid].stride || j % state[wid].stride == state[wid].offset);
+                state[wid].span[j].validscan  = !allinval && !allover && !allunder && (!state[wid].scfield || (state[wid].scfield && !(state[wid].sckeepodd ^ (j & 1))));
+                state[wid].span[j].validline  = state[wid].span[j].validscan && (!state[wid].stride || j % state[wid].stride == state[wid].offset);
 
             }
 
@@ -2263,7 +2431,8 @@ static void edgewalker_for_prims(uint32_t wid, int32_t* ewdata)
             {
                 state[wid].span[j].lx = minxmx;
                 state[wid].span[j].rx = maxxhx;
-                state[wid].span[j].validline  = !allinval && !allover && !allunder && (!state[wid].scfield || (state[wid].scfield && !(state[wid].sckeepodd ^ (j & 1)))) && (!state[wid].stride || j % state[wid].stride == state[wid].offset);
+                state[wid].span[j].validscan  = !allinval && !allover && !allunder && (!state[wid].scfield || (state[wid].scfield && !(state[wid].sckeepodd ^ (j & 1))));
+                state[wid].span[j].validline  = state[wid].span[j].validscan && (!state[wid].stride || j % state[wid].stride == state[wid].offset);
             }
 
         }
@@ -2282,6 +2451,9 @@ static void edgewalker_for_prims(uint32_t wid, int32_t* ewdata)
 
 
 
+    if (config.stats)
+        count_spans(wid, yhlimit >> 2, yllimit >> 2, flip);
+
     switch(state[wid].other_modes.cycle_type)
     {
         case CYCLE_TYPE_1:
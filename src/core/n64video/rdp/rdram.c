@@ -1,11 +1,10 @@
 #ifdef N64VIDEO_C
 
 //
-// rdram.c: RDRAM memory interface
+// rdram.c: RDRAM memory interface. the state and the reads are declared
+// in internal.h, which shares them with the VI
 //
 
-#define RDRAM_MASK 0x00ffffff
-
 // macros used to interface with AL's code
 #define RREADADDR8(rdst, in) {(rdst) = rdram_read_idx8((in));}
 #define RREADIDX16(rdst, in) {(rdst) = rdram_read_idx16((in));}
@@ -23,15 +22,19 @@
 
 #define PAIRWRITE8(in, rval, hval) rdram_write_pair8((in), (rval), (hval))
 
-// pointer indexing limits for aliasing RDRAM reads and writes
-static uint32_t idxlim8;
-static uint32_t idxlim16;
-static uint32_t idxlim32;
+uint32_t idxlim8;
+uint32_t idxlim16;
+uint32_t idxlim32;
+
+uint32_t* rdram32;
+uint16_t* rdram16;
+uint8_t* rdram8;
+uint8_t rdram_hidden[RDRAM_MAX_SIZE / 2];
 
-static uint32_t* rdram32;
-static uint16_t* rdram16;
-static uint8_t* rdram8;
-static uint8_t rdram_hidden[RDRAM_MAX_SIZE / 2];
+// dirty flags for RDRAM blocks, set on RDP writes and CPU invalidation and
+// cleared by the VI after scanning out a frame
+#define RDRAM_DIRTY_SHIFT 8
+static uint8_t rdram_dirty[RDRAM_MAX_SIZE >> RDRAM_DIRTY_SHIFT];
 
 static void rdram_init(void)
 {
@@ -44,54 +47,50 @@ static void rdram_init(void)
     rdram8 = config.gfx.rdram;
 
     memset(rdram_hidden, 3, sizeof(rdram_hidden));
+    memset(rdram_dirty, 1, sizeof(rdram_dirty));
 }
 
-static STRICTINLINE bool rdram_valid_idx8(uint32_t in)
+static STRICTINLINE void rdram_mark_dirty(uint32_t addr)
 {
-    return in <= idxlim8;
+    rdram_dirty[addr >> RDRAM_DIRTY_SHIFT] = 1;
 }
 
-static STRICTINLINE bool rdram_valid_idx16(uint32_t in)
+static void rdram_mark_dirty_range(uint32_t addr, uint32_t length)
 {
-    return in <= idxlim16;
-}
+    if (!length || addr > idxlim8) {
+        return;
+    }
 
-static STRICTINLINE bool rdram_valid_idx32(uint32_t in)
-{
-    return in <= idxlim32;
+    uint32_t last = MIN(addr + length - 1, idxlim8);
+    memset(&rdram_dirty[addr >> RDRAM_DIRTY_SHIFT], 1, (last >> RDRAM_DIRTY_SHIFT) - (addr >> RDRAM_DIRTY_SHIFT) + 1);
 }
 
-static STRICTINLINE uint8_t rdram_read_idx8(uint32_t in)
+bool rdram_test_dirty(uint32_t addr, uint32_t length)
 {
-    in &= RDRAM_MASK;
-    return rdram_valid_idx8(in) ? rdram8[in ^ BYTE_ADDR_XOR] : 0;
-}
+    if (!length || addr > idxlim8) {
+        return false;
+    }
 
-static STRICTINLINE uint8_t rdram_read_idx8_fast(uint32_t in)
-{
-    return rdram8[in ^ BYTE_ADDR_XOR];
-}
+    uint32_t first = addr >> RDRAM_DIRTY_SHIFT;
+    uint32_t last = MIN(addr + length - 1, idxlim8) >> RDRAM_DIRTY_SHIFT;
 
-static STRICTINLINE uint16_t rdram_read_idx16(uint32_t in)
-{
-    in &= RDRAM_MASK >> 1;
-    return rdram_valid_idx16(in) ? rdram16[in ^ WORD_ADDR_XOR] : 0;
-}
+    for (uint32_t i = first; i <= last; i++) {
+        if (rdram_dirty[i]) {
+            return true;
+        }
+    }
 
-static STRICTINLINE uint16_t rdram_read_idx16_fast(uint32_t in)
-{
-    return rdram16[in ^ WORD_ADDR_XOR];
+    return false;
 }
 
-static STRICTINLINE uint32_t rdram_read_idx32(uint32_t in)
+void rdram_clear_dirty(uint32_t addr, uint32_t length)
 {
-    in &= RDRAM_MASK >> 2;
-    return rdram_valid_idx32(in) ? rdram32[in] : 0;
-}
+    if (!length || addr > idxlim8) {
+        return;
+    }
 
-static STRICTINLINE uint32_t rdram_read_idx32_fast(uint32_t in)
-{
-    return rdram32[in];
+    uint32_t last = MIN(addr + length - 1, idxlim8);
+    memset(&rdram_dirty[addr >> RDRAM_DIRTY_SHIFT], 0, (last >> RDRAM_DIRTY_SHIFT) - (addr >> RDRAM_DIRTY_SHIFT) + 1);
 }
 
 static STRICTINLINE void rdram_write_idx8(uint32_t in, uint8_t val)
@@ -99,6 +98,7 @@ static STRICTINLINE void rdram_write_idx8(uint32_t in, uint8_t val)
     in &= RDRAM_MASK;
     if (rdram_valid_idx8(in)) {
         rdram8[in ^ BYTE_ADDR_XOR] = val;
+        rdram_mark_dirty(in);
     }
 }
 
@@ -107,6 +107,7 @@ static STRICTINLINE void rdram_write_idx16(uint32_t in, uint16_t val)
     in &= RDRAM_MASK >> 1;
     if (rdram_valid_idx16(in)) {
         rdram16[in ^ WORD_ADDR_XOR] = val;
+        rdram_mark_dirty(in << 1);
     }
 }
 
@@ -115,17 +116,7 @@ static STRICTINLINE void rdram_write_idx32(uint32_t in, uint32_t val)
     in &= RDRAM_MASK >> 2;
     if (rdram_valid_idx32(in)) {
         rdram32[in] = val;
-    }
-}
-
-static STRICTINLINE void rdram_read_pair16(uint16_t* rdst, uint8_t* hdst, uint32_t in)
-{
-    in &= RDRAM_MASK >> 1;
-    if (rdram_valid_idx16(in)) {
-        *rdst = rdram16[in ^ WORD_ADDR_XOR];
-        *hdst = rdram_hidden[in];
-    } else {
-        *rdst = *hdst = 0;
+        rdram_mark_dirty(in << 2);
     }
 }
 
@@ -137,6 +128,7 @@ static STRICTINLINE void rdram_write_pair8(uint32_t in, uint8_t rval, uint8_t hv
         if (in & 1) {
             rdram_hidden[in >> 1] = hval;
         }
+        rdram_mark_dirty(in);
     }
 }
 
@@ -146,6 +138,7 @@ static STRICTINLINE void rdram_write_pair16(uint32_t in, uint16_t rval, uint8_t
     if (rdram_valid_idx16(in)) {
         rdram16[in ^ WORD_ADDR_XOR] = rval;
         rdram_hidden[in] = hval;
+        rdram_mark_dirty(in << 1);
     }
 }
 
@@ -156,6 +149,7 @@ static STRICTINLINE void rdram_write_pair32(uint32_t in, uint32_t rval, uint8_t
         rdram32[in] = rval;
         rdram_hidden[in << 1] = hval0;
         rdram_hidden[(in << 1) + 1] = hval1;
+        rdram_mark_dirty(in << 2);
     }
 }
 
@@ -621,7 +621,7 @@ static STRICTINLINE void tclod_1cycle_current(uint32_t wid, int32_t* sss, int32_
         int nextscan = scanline + 1;
 
 
-        if (state[wid].span[nextscan].validline)
+        if (state[wid].span[nextscan].validscan)
         {
             if (!sigs->endspan || !sigs->longspan)
             {
@@ -694,7 +694,7 @@ static STRICTINLINE void tclod_1cycle_current_simple(uint32_t wid, int32_t* sss,
     {
 
         int nextscan = scanline + 1;
-        if (state[wid].span[nextscan].validline)
+        if (state[wid].span[nextscan].validscan)
         {
             if (!sigs->endspan || !sigs->longspan)
             {
@@ -771,7 +771,7 @@ static STRICTINLINE void tclod_1cycle_next(uint32_t wid, int32_t* sss, int32_t*
 
         int nextscan = scanline + 1;
 
-        if (state[wid].span[nextscan].validline)
+        if (state[wid].span[nextscan].validscan)
         {
 
             if (!sigs->nextspan)
@@ -131,7 +131,7 @@ static STRICTINLINE void get_texel1_1cycle(uint32_t wid, int32_t* s1, int32_t* t
 {
     int32_t nexts, nextt, nextsw;
 
-    if (!sigs->endspan || !sigs->longspan || !state[wid].span[scanline + 1].validline)
+    if (!sigs->endspan || !sigs->longspan || !state[wid].span[scanline + 1].validscan)
     {
 
 
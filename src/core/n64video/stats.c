@@ -0,0 +1,148 @@
+#ifdef N64VIDEO_C
+
+struct stats_worker_data
+{
+    struct n64video_cmd_stats cmd[64];
+    struct n64video_span_stats spans[DP_SPANS_NUM];
+    uint32_t cmd_id;    // command that is currently run
+    uint32_t span_path; // span path of the primitive that is currently rendered
+    uint64_t busy;      // time spent running commands in the last flush
+};
+
+// statistics of each worker, which are aligned and padded to whole cache
+// lines so that the workers don't share any
+static CACHE_ALIGNED union
+{
+    struct stats_worker_data d;
+    uint8_t pad[(sizeof(struct stats_worker_data) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE];
+} stats_worker[PARALLEL_MAX_WORKERS];
+
+// statistics merged from all workers
+static struct n64video_stats stats_total;
+
+// timing of the current and the last complete frame
+struct n64video_frame_stats stats_frame;
+static struct n64video_frame_stats stats_frame_last;
+
+uint64_t stats_time(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static STRICTINLINE void stats_cmd_begin(uint32_t wid, uint32_t cmd_id)
+{
+    stats_worker[wid].d.cmd_id = cmd_id;
+}
+
+static STRICTINLINE void stats_cmd_end(uint32_t wid, uint64_t time)
+{
+    struct n64video_cmd_stats* cmd = &stats_worker[wid].d.cmd[stats_worker[wid].d.cmd_id];
+    cmd->count++;
+    cmd->time += time;
+}
+
+static STRICTINLINE void stats_add_spans(uint32_t wid, enum dp_span_path path, uint64_t spans, uint64_t pixels)
+{
+    struct stats_worker_data* data = &stats_worker[wid].d;
+    data->cmd[data->cmd_id].pixels += pixels;
+    data->spans[path].prims++;
+    data->spans[path].spans += spans;
+    data->spans[path].pixels += pixels;
+    data->span_path = path;
+}
+
+static STRICTINLINE void stats_add_rejects(uint32_t wid, uint32_t z, uint32_t alpha, uint32_t cvg)
+{
+    struct n64video_span_stats* spans = &stats_worker[wid].d.spans[stats_worker[wid].d.span_path];
+    spans->z_rejected += z;
+    spans->alpha_rejected += alpha;
+    spans->cvg_rejected += cvg;
+}
+
+// merges the statistics of all workers, which must be idle
+static void stats_merge(void)
+{
+    uint32_t num_workers = config.parallel ? parallel_num_workers() : 1;
+
+    for (uint32_t i = 0; i < num_workers; i++) {
+        struct stats_worker_data* data = &stats_worker[i].d;
+
+        for (uint32_t id = 0; id < 64; id++) {
+            // every worker runs every command, so only count them once
+            if (!i) {
+                stats_total.cmd[id].count += data->cmd[id].count;
+            }
+            stats_total.cmd[id].time += data->cmd[id].time;
+            stats_total.cmd[id].pixels += data->cmd[id].pixels;
+        }
+
+        for (uint32_t path = 0; path < DP_SPANS_NUM; path++) {
+            // every worker walks every primitive, but only renders its own
+            // spans of it
+            if (!i) {
+                stats_total.spans[path].prims += data->spans[path].prims;
+            }
+            stats_total.spans[path].spans += data->spans[path].spans;
+            stats_total.spans[path].pixels += data->spans[path].pixels;
+            stats_total.spans[path].z_rejected += data->spans[path].z_rejected;
+            stats_total.spans[path].alpha_rejected += data->spans[path].alpha_rejected;
+            stats_total.spans[path].cvg_rejected += data->spans[path].cvg_rejected;
+        }
+
+        memset(data->cmd, 0, sizeof(data->cmd));
+        memset(data->spans, 0, sizeof(data->spans));
+    }
+}
+
+static STRICTINLINE void stats_worker_busy(uint32_t wid, uint64_t time)
+{
+    stats_worker[wid].d.busy = time;
+}
+
+// accounts a flush of num_cmds buffered commands that took the given time
+// on the main thread, which runs worker 0
+static void stats_flush(uint64_t time, uint32_t num_cmds)
+{
+    uint32_t num_workers = parallel_num_workers();
+
+    for (uint32_t i = 0; i < num_workers; i++) {
+        uint64_t busy = MIN(stats_worker[i].d.busy, time);
+        stats_frame.worker_busy[i] += busy;
+        stats_frame.worker_idle[i] += time - busy;
+    }
+
+    stats_frame.wait += time - MIN(stats_worker[0].d.busy, time);
+    stats_frame.flushes++;
+    stats_frame.flushed_cmds += num_cmds;
+}
+
+// completes the timing of the current frame and starts the next one
+void stats_frame_end(void)
+{
+    stats_frame.num_workers = config.parallel ? parallel_num_workers() : 1;
+    stats_frame_last = stats_frame;
+    memset(&stats_frame, 0, sizeof(stats_frame));
+}
+
+void n64video_get_stats(struct n64video_stats* stats)
+{
+    stats_merge();
+    *stats = stats_total;
+}
+
+void n64video_reset_stats(void)
+{
+    stats_merge();
+    memset(&stats_total, 0, sizeof(stats_total));
+    memset(&stats_frame, 0, sizeof(stats_frame));
+    memset(&stats_frame_last, 0, sizeof(stats_frame_last));
+}
+
+void n64video_get_frame_stats(struct n64video_frame_stats* stats)
+{
+    *stats = stats_frame_last;
+}
+
+#endif // N64VIDEO_C
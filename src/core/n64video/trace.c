@@ -0,0 +1,119 @@
+#ifdef N64VIDEO_C
+
+// number of events kept per thread, older ones are overwritten
+#define TRACE_RING_SIZE 0x4000
+
+struct trace_event
+{
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+// each ring is only written by its own thread, so no locking is needed.
+// they are aligned and padded to whole cache lines so that the threads don't
+// share any
+static CACHE_ALIGNED union
+{
+    struct
+    {
+        struct trace_event* events;
+        uint32_t pos;
+        uint32_t count;
+    } d;
+    uint8_t pad[CACHE_LINE_SIZE];
+} trace_ring[PARALLEL_MAX_WORKERS + 1];
+
+// records an event that started at the given stats_time
+void trace_add(uint32_t tid, const char* name, uint64_t start)
+{
+    struct trace_event* event = &trace_ring[tid].d.events[trace_ring[tid].d.pos];
+    event->name = name;
+    event->start = start;
+    event->duration = stats_time() - start;
+
+    trace_ring[tid].d.pos = (trace_ring[tid].d.pos + 1) % TRACE_RING_SIZE;
+    if (trace_ring[tid].d.count < TRACE_RING_SIZE) {
+        trace_ring[tid].d.count++;
+    }
+}
+
+static void trace_close(void)
+{
+    for (uint32_t i = 0; i <= PARALLEL_MAX_WORKERS; i++) {
+        free(trace_ring[i].d.events);
+        trace_ring[i].d.events = NULL;
+        trace_ring[i].d.pos = 0;
+        trace_ring[i].d.count = 0;
+    }
+}
+
+static void trace_init(void)
+{
+    trace_close();
+
+    if (!config.trace) {
+        return;
+    }
+
+    uint32_t num_workers = config.parallel ? parallel_num_workers() : 1;
+
+    for (uint32_t i = 0; i <= PARALLEL_MAX_WORKERS; i++) {
+        if (i >= num_workers && i != TRACE_ASYNC) {
+            continue;
+        }
+
+        trace_ring[i].d.events = malloc(TRACE_RING_SIZE * sizeof(struct trace_event));
+        if (!trace_ring[i].d.events) {
+            msg_error("Failed to allocate trace buffer for thread %d", i);
+        }
+    }
+}
+
+bool n64video_trace_dump(const char* path)
+{
+    if (!config.trace) {
+        return false;
+    }
+
+    // the background thread must not write to its ring while it is read
+    parallel_wait_async();
+
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+
+    bool first = true;
+    for (uint32_t i = 0; i <= PARALLEL_MAX_WORKERS; i++) {
+        if (!trace_ring[i].d.events) {
+            continue;
+        }
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+            first ? "" : ",\n", i, i == TRACE_ASYNC ? "async" : "worker", i == TRACE_ASYNC ? 0 : i);
+        first = false;
+
+        // start with the oldest event
+        uint32_t pos = (trace_ring[i].d.pos + TRACE_RING_SIZE - trace_ring[i].d.count) % TRACE_RING_SIZE;
+        for (uint32_t j = 0; j < trace_ring[i].d.count; j++) {
+            struct trace_event* event = &trace_ring[i].d.events[(pos + j) % TRACE_RING_SIZE];
+
+            // timestamps are in microseconds
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event->name, i, event->start / 1000.0, event->duration / 1000.0);
+        }
+
+        // start over so the next dump only contains new events
+        trace_ring[i].d.pos = 0;
+        trace_ring[i].d.count = 0;
+    }
+
+    fprintf(fp, "\n]}\n");
+
+    return fclose(fp) == 0;
+}
+
+#endif // N64VIDEO_C
@@ -1,4 +1,14 @@
-#ifdef N64VIDEO_C
+#include "internal.h"
+#include "../msg.h"
+#include "../vdac.h"
+#include "../parallel.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 // anamorphic NTSC resolution
 #define H_RES_NTSC 640
@@ -48,6 +58,59 @@ struct vi_reg_ctrl
     bool dither_filter_enable;
 };
 
+static struct n64video_config vi_config;
+
+static struct
+{
+    bool vbusclock, nolerp;
+} vi_onetimewarnings;
+
+// RDRAM as seen by the filters, which is either RDRAM itself or a snapshot of
+// the frame buffer area when the filters run in the background. the snapshot
+// is only allocated once it is used
+static uint16_t* vi_rdram16;
+static uint32_t* vi_rdram32;
+static uint8_t* vi_rdram_hidden;
+static uint32_t* vi_rdram_snapshot;
+static uint8_t* vi_rdram_hidden_snapshot;
+
+static STRICTINLINE uint16_t vi_rdram_read_idx16(uint32_t in)
+{
+    in &= RDRAM_MASK >> 1;
+    return rdram_valid_idx16(in) ? vi_rdram16[in ^ WORD_ADDR_XOR] : 0;
+}
+
+static STRICTINLINE uint16_t vi_rdram_read_idx16_fast(uint32_t in)
+{
+    return vi_rdram16[in ^ WORD_ADDR_XOR];
+}
+
+static STRICTINLINE uint32_t vi_rdram_read_idx32(uint32_t in)
+{
+    in &= RDRAM_MASK >> 2;
+    return rdram_valid_idx32(in) ? vi_rdram32[in] : 0;
+}
+
+static STRICTINLINE uint32_t vi_rdram_read_idx32_fast(uint32_t in)
+{
+    return vi_rdram32[in];
+}
+
+static STRICTINLINE void vi_rdram_read_pair16(uint16_t* rdst, uint8_t* hdst, uint32_t in)
+{
+    in &= RDRAM_MASK >> 1;
+    if (rdram_valid_idx16(in)) {
+        *rdst = vi_rdram16[in ^ WORD_ADDR_XOR];
+        *hdst = vi_rdram_hidden[in];
+    } else {
+        *rdst = *hdst = 0;
+    }
+}
+
+// include guard to prevent compilation of the filter modules as translation
+// units
+#define N64VIDEO_VI_C
+
 typedef void(*vi_fetch_filter_func)(struct rgba*, uint32_t, uint32_t, struct vi_reg_ctrl, uint32_t, uint32_t);
 
 #include "vi/gamma.c"
@@ -79,13 +142,32 @@ static uint32_t tvfadeoutstate[PRESCALE_HEIGHT];
 static uint32_t rseed[PARALLEL_MAX_WORKERS];
 static uint32_t zb_address;
 
-// prescale buffer
-static struct rgba prescale[PRESCALE_WIDTH * PRESCALE_HEIGHT];
+// prescale buffer, which grows to the number of rows used by the VI modes
+// seen so far. it is provided by the VDAC if it has staging buffers, which
+// are used in turns, so that a frame can be filtered while the previous ones
+// are still uploaded.
+static struct rgba* prescale;
+static struct rgba* prescale_buffers[VDAC_MAP_MAX];
+static uint32_t prescale_buffer;
+static bool prescale_mapped;
+static int32_t prescale_rows;
 static uint32_t prescale_ptr;
 static int32_t linecount;
 
+// range of columns in each prescale row that may not be black and the
+// staging buffers that hold the current contents of the row
+struct prescale_range
+{
+    int32_t start;
+    int32_t end;
+    uint32_t buffers;
+};
+
+static struct prescale_range* prescale_ranges;
+
 // parsed VI registers
 static uint32_t** vi_reg_ptr;
+static uint32_t vi_control;
 static struct vi_reg_ctrl ctrl;
 static int32_t hres, vres;
 static int32_t hres_raw, vres_raw;
@@ -93,14 +175,158 @@ static int32_t v_start;
 static int32_t h_start;
 static int32_t v_current_line;
 
-static void vi_init(void)
+// state of the last filtered frame in prescale
+struct vi_frame_state
 {
-    vdac_init(&config);
+    uint32_t vi_control;
+    uint32_t frame_buffer;
+    int32_t vi_width_low;
+    uint32_t x_start;
+    uint32_t x_add;
+    uint32_t y_start;
+    uint32_t y_add;
+    int32_t hres;
+    int32_t vres;
+    uint32_t prescale_ptr;
+    int32_t linecount;
+    int32_t minhpass;
+    int32_t maxhpass;
+};
+
+static struct vi_frame_state prev_frame;
+static bool prev_frame_valid;
+
+// output lines that need to be filtered again in the current frame
+static bool vi_line_dirty[PRESCALE_HEIGHT];
+
+// number of workers filtering the current frame
+static uint32_t vi_num_workers;
+
+// filtered frame that is presented on the next update if pipelined
+static struct frame_buffer vi_pending_fb;
+static bool vi_pending;
+static bool vi_pending_valid;
+static bool vi_flushed_valid;
+
+// last filtered frame, which is returned by n64video_read_screen
+static struct frame_buffer vi_capture_fb;
+static bool vi_capture_valid;
+
+// source column and horizontal fraction of each output pixel
+static int32_t vi_column_x[PRESCALE_WIDTH];
+static uint8_t vi_column_frac[PRESCALE_WIDTH];
+
+static void prescale_reserve(int32_t rows)
+{
+    int32_t i;
+
+    // filter directly into the staging buffers of the VDAC if possible, which
+    // have to be mapped again for each frame
+    uint32_t index;
+    bool mapped = vdac_map((size_t)MAX(rows, prescale_rows) * PRESCALE_WIDTH, prescale_buffers, &index) > 0;
+    if (mapped) {
+        prescale = prescale_buffers[index];
+        prescale_buffer = index;
+        prescale_mapped = true;
+    }
+
+    if (rows <= prescale_rows) {
+        return;
+    }
+
+    if (!mapped) {
+        prescale = realloc(prescale, (size_t)rows * PRESCALE_WIDTH * sizeof(struct rgba));
+        prescale_buffers[0] = prescale;
+        prescale_buffer = 0;
+    }
+
+    prescale_ranges = realloc(prescale_ranges, (size_t)rows * sizeof(struct prescale_range));
+
+    if (!prescale || !prescale_ranges) {
+        msg_error("Failed to allocate %d prescale rows", rows);
+    }
+
+    memset(&prescale[prescale_rows * PRESCALE_WIDTH], 0, (size_t)(rows - prescale_rows) * PRESCALE_WIDTH * sizeof(struct rgba));
+
+    for (i = prescale_rows; i < rows; i++) {
+        prescale_ranges[i].start = PRESCALE_WIDTH;
+        prescale_ranges[i].end = 0;
+        prescale_ranges[i].buffers = 1 << prescale_buffer;
+    }
+
+    prescale_rows = rows;
+}
+
+// makes the current buffer the only one that holds the current contents of
+// a prescale row, before columns start to end of it are overwritten. the
+// other columns are copied from another buffer if it's not up to date.
+static void prescale_own(int32_t row, int32_t start, int32_t end)
+{
+    struct prescale_range* range = &prescale_ranges[row];
+    uint32_t current = 1 << prescale_buffer;
+
+    if (!(range->buffers & current)) {
+        uint32_t src = 0;
+        while (!(range->buffers & (1 << src))) {
+            src++;
+        }
+
+        struct rgba* from = &prescale_buffers[src][row * PRESCALE_WIDTH];
+        struct rgba* to = &prescale[row * PRESCALE_WIDTH];
+        memcpy(to, from, start * sizeof(struct rgba));
+        memcpy(to + end, from + end, (PRESCALE_WIDTH - end) * sizeof(struct rgba));
+    }
+
+    range->buffers = current;
+}
+
+// marks columns of a prescale row as written
+static void prescale_mark(int32_t row, int32_t start, int32_t end)
+{
+    struct prescale_range* range = &prescale_ranges[row];
+    range->start = MIN(range->start, start);
+    range->end = MAX(range->end, end);
+}
+
+// clears columns of a prescale row, skipping the parts that are black already
+static void prescale_clear(int32_t row, int32_t start, int32_t end)
+{
+    struct prescale_range* range = &prescale_ranges[row];
+    int32_t clear_start = MAX(start, range->start);
+    int32_t clear_end = MIN(end, range->end);
+
+    if (clear_start >= clear_end) {
+        return;
+    }
+
+    prescale_own(row, clear_start, clear_end);
+    memset(&prescale[row * PRESCALE_WIDTH + clear_start], 0, (clear_end - clear_start) * sizeof(struct rgba));
+
+    // shrink the range if one of its ends has been cleared
+    if (start <= range->start && end >= range->end) {
+        range->start = PRESCALE_WIDTH;
+        range->end = 0;
+    } else if (start <= range->start) {
+        range->start = end;
+    } else if (end >= range->end) {
+        range->end = start;
+    }
+}
+
+void vi_init(struct n64video_config* config)
+{
+    int32_t i;
+
+    vi_config = *config;
+
+    vdac_init(&vi_config);
 
     vi_gamma_init();
     vi_restore_init();
 
-    memset(prescale, 0, sizeof(prescale));
+    for (i = 0; i < prescale_rows; i++) {
+        prescale_clear(i, 0, PRESCALE_WIDTH);
+    }
 
     prevvicurrent = 0;
     emucontrolsvicurrent = -1;
@@ -108,8 +334,30 @@ static void vi_init(void)
     oldvstart = 1337;
     prevwasblank = false;
     zb_address = 0;
+    prev_frame_valid = false;
+    vi_pending = false;
+    vi_flushed_valid = false;
+
+    vi_rdram16 = rdram16;
+    vi_rdram32 = rdram32;
+    vi_rdram_hidden = rdram_hidden;
 
     memset(rseed, 3, sizeof(rseed));
+    memset(&vi_onetimewarnings, 0, sizeof(vi_onetimewarnings));
+}
+
+// gets the contiguous block of rows to process by a worker, which keeps its
+// line caches warm and its writes to prescale sequential
+static void vi_worker_rows(uint32_t worker_id, int32_t rows, int32_t* begin, int32_t* end)
+{
+    *begin = 0;
+    *end = rows;
+
+    if (vi_num_workers > 1 && rows > 0) {
+        int32_t workers = (int32_t)vi_num_workers;
+        *begin = rows * (int32_t)worker_id / workers;
+        *end = rows * ((int32_t)worker_id + 1) / workers;
+    }
 }
 
 static void vi_process_full_parallel(uint32_t worker_id)
@@ -137,45 +385,84 @@ static void vi_process_full_parallel(uint32_t worker_id)
     int32_t prev_scan_x = 0, scan_x = 0, next_scan_x = 0, far_scan_x = 0;
     int32_t prev_x = 0, cur_x = 0, next_x = 0, far_x = 0;
 
-    bool cache_init = false;
+    // source rows currently held by the caches, as (row << 1) | fetch bug
+    uint32_t cache_key = UINT32_MAX, cache_next_key = UINT32_MAX;
 
     pixels = 0;
 
-    int32_t y_begin = 0;
-    int32_t y_end = vres;
-    int32_t y_inc = 1;
+    int32_t y_begin, y_end;
+    vi_worker_rows(worker_id, vres, &y_begin, &y_end);
 
-    if (config.parallel) {
-        y_begin = worker_id;
-        y_inc = parallel_num_workers();
-    }
-
-    for (y = y_begin; y < y_end; y += y_inc) {
+    for (y = y_begin; y < y_end; y++) {
         int32_t x;
-        uint32_t x_offs = x_start;
         uint32_t curry = y_start + y * y_add;
         uint32_t nexty = y_start + (y + 1) * y_add;
         uint32_t prevy = curry >> 10;
 
-        cache_marker = cache_next_marker = cache_marker_init;
-        if (ctrl.divot_enable) {
-            divot_cache_marker = divot_cache_next_marker = cache_marker_init;
-        }
-
         struct rgba* pixel_row = &prescale[prescale_ptr + linecount * y];
 
         yfrac = (curry >> 5) & 0x1f;
         pixels = vi_width_low * prevy;
         nextpixels = vi_width_low + pixels;
 
+        // the fetch bug state is 2 for lines that share their source row
+        // with the next line and decays by one per line otherwise. derive it
+        // from the neighbor lines instead of carrying it over, so it doesn't
+        // depend on the line the worker started with
         if (prevy == (nexty >> 10)) {
             fetchbugstate = 2;
+        } else if (y > 0 && ((y_start + (y - 1) * y_add) >> 10) == prevy) {
+            fetchbugstate = 1;
         } else {
-            fetchbugstate >>= 1;
+            fetchbugstate = 0;
+        }
+
+        // keep the line from the previous frame in prescale if its source
+        // hasn't changed
+        if (!vi_line_dirty[y]) {
+            continue;
+        }
+
+        // reuse source rows that were already fetched and filtered for the
+        // previous line, which is the case for most lines if y_add <= 0x400.
+        // the fetched columns are the same for every line, so the caches
+        // remain complete
+        uint32_t key = prevy << 1;
+        uint32_t next_key = ((prevy + 1) << 1) | (fetchbugstate == 1);
+
+        if (cache_key != key && cache_next_key == key) {
+            struct rgba* tempccvgptr = viaa_cache;
+            viaa_cache = viaa_cache_next;
+            viaa_cache_next = tempccvgptr;
+
+            tempccvgptr = divot_cache;
+            divot_cache = divot_cache_next;
+            divot_cache_next = tempccvgptr;
+
+            int32_t tempmarker = cache_marker;
+            cache_marker = cache_next_marker;
+            cache_next_marker = tempmarker;
+
+            tempmarker = divot_cache_marker;
+            divot_cache_marker = divot_cache_next_marker;
+            divot_cache_next_marker = tempmarker;
+
+            cache_next_key = cache_key;
+            cache_key = key;
+        }
+
+        if (cache_key != key) {
+            cache_marker = divot_cache_marker = cache_marker_init;
+            cache_key = key;
         }
 
-        for (x = 0; x < hres; x++, x_offs += x_add) {
-            line_x = x_offs >> 10;
+        if (cache_next_key != next_key) {
+            cache_next_marker = divot_cache_next_marker = cache_marker_init;
+            cache_next_key = next_key;
+        }
+
+        for (x = 0; x < hres; x++) {
+            line_x = vi_column_x[x];
             prev_line_x = line_x - 1;
             next_line_x = line_x + 1;
             far_line_x = line_x + 2;
@@ -195,7 +482,7 @@ static void vi_process_full_parallel(uint32_t worker_id)
             next_line_x++;
             far_line_x++;
 
-            xfrac = (x_offs >> 5) & 0x1f;
+            xfrac = vi_column_frac[x];
 
             if (prev_line_x > cache_marker) {
                 vi_fetch_filter_ptr(&viaa_cache[prev_line_x], frame_buffer, prev_x, ctrl, vi_width_low, 0);
@@ -281,30 +568,205 @@ static void vi_process_full_parallel(uint32_t worker_id)
 
             if (x >= minhpass && x < maxhpass) {
                 *pixel = color;
-                gamma_filters(pixel, ctrl.gamma_enable, ctrl.gamma_dither_enable, &rseed[worker_id]);
             } else {
                 pixel->r = pixel->g = pixel->b = 0;
             }
         }
 
-        if (!cache_init && y_add == 0x400) {
-            cache_marker = cache_next_marker;
-            cache_next_marker = cache_marker_init;
+        gamma_filters_row(&pixel_row[minhpass], MIN(maxhpass, hres) - minhpass, ctrl.gamma_enable, ctrl.gamma_dither_enable, &rseed[worker_id]);
+    }
+}
 
-            struct rgba* tempccvgptr = viaa_cache;
-            viaa_cache = viaa_cache_next;
-            viaa_cache_next = tempccvgptr;
-            if (ctrl.divot_enable) {
-                divot_cache_marker = divot_cache_next_marker;
-                divot_cache_next_marker = cache_marker_init;
-                tempccvgptr = divot_cache;
-                divot_cache = divot_cache_next;
-                divot_cache_next = tempccvgptr;
-            }
+// gets the RDRAM byte range read by the filters for a range of source rows,
+// which includes the neighbor pixels and can go beyond the RDRAM size
+static void vi_row_area(int64_t row_first, int64_t row_last, int64_t* start, int64_t* end)
+{
+    uint32_t shift = (ctrl.type & 1) ? 2 : 1;
+    int64_t origin = frame_buffer >> shift;
+    int64_t row_size = MAX((int64_t)((x_start + hres * x_add) >> 10) + 4, vi_width_low);
+    *start = MAX((origin + row_first * vi_width_low - 4) << shift, 0);
+    *end = (origin + row_last * vi_width_low + row_size) << shift;
+}
+
+// gets the RDRAM byte range read by the filters for the whole frame,
+// including the neighbors of the first and last rows
+static void vi_frame_area(int64_t* start, int64_t* end)
+{
+    int64_t row_first = (int64_t)(y_start >> 10) - 1;
+    int64_t row_last = (int64_t)((y_start + vres * y_add) >> 10) + 2;
+    vi_row_area(row_first, row_last, start, end);
+}
+
+static bool vi_update_dirty_lines(void)
+{
+    int32_t y;
+
+    if (!vi_config.vi.skip_unchanged) {
+        memset(vi_line_dirty, 1, sizeof(vi_line_dirty));
+        return true;
+    }
+
+    struct vi_frame_state frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.vi_control = vi_control;
+    frame.frame_buffer = frame_buffer;
+    frame.vi_width_low = vi_width_low;
+    frame.x_start = x_start;
+    frame.x_add = x_add;
+    frame.y_start = y_start;
+    frame.y_add = y_add;
+    frame.hres = hres;
+    frame.vres = vres;
+    frame.prescale_ptr = prescale_ptr;
+    frame.linecount = linecount;
+    frame.minhpass = minhpass;
+    frame.maxhpass = maxhpass;
+
+    int64_t start, end;
+    vi_frame_area(&start, &end);
+
+    // all lines have to be filtered if the VI state has changed, if reads
+    // beyond the RDRAM address mask wrap around or if dithering adds new
+    // noise to the output
+    bool all_dirty = !prev_frame_valid || memcmp(&frame, &prev_frame, sizeof(frame)) ||
+        end > RDRAM_MASK || ctrl.gamma_dither_enable;
+
+    prev_frame = frame;
+    prev_frame_valid = true;
+
+    bool any_dirty = all_dirty;
+
+    // otherwise, only filter lines where the source rows or their neighbors
+    // used by the AA, divot and restore filters have been written
+    for (y = 0; y < vres; y++) {
+        if (all_dirty) {
+            vi_line_dirty[y] = true;
+            continue;
+        }
+
+        int64_t prevy = (y_start + y * y_add) >> 10;
+        int64_t line_start, line_end;
+        vi_row_area(prevy - 1, prevy + 2, &line_start, &line_end);
+
+        vi_line_dirty[y] = rdram_test_dirty((uint32_t)line_start, (uint32_t)(line_end - line_start));
+        any_dirty |= vi_line_dirty[y];
+    }
 
-            cache_init = true;
+    rdram_clear_dirty((uint32_t)start, (uint32_t)(end - start));
+
+    return any_dirty;
+}
+
+static void vi_process_full_async(void)
+{
+    uint64_t start = vi_config.trace ? stats_time() : 0;
+
+    vi_process_full_parallel(0);
+
+    if (vi_config.trace) {
+        trace_add(TRACE_ASYNC, "vi_process_full_async", start);
+    }
+}
+
+// copies the frame buffer area read by the filters to the snapshot and lets
+// the filters read from it
+static void vi_snapshot_rdram(void)
+{
+    int64_t start, end;
+    vi_frame_area(&start, &end);
+
+    int64_t size = (int64_t)idxlim8 + 1;
+
+    if (!vi_rdram_snapshot) {
+        vi_rdram_snapshot = malloc((size_t)size);
+        vi_rdram_hidden_snapshot = malloc((size_t)size >> 1);
+
+        if (!vi_rdram_snapshot || !vi_rdram_hidden_snapshot) {
+            msg_error("Failed to allocate RDRAM snapshot of %d bytes", (int)size);
         }
     }
+
+    // reads beyond the RDRAM address mask wrap around, copy everything
+    if (end > RDRAM_MASK) {
+        start = 0;
+        end = size;
+    }
+
+    start &= ~3;
+    end = MIN((end + 3) & ~3, size);
+
+    if (start < end) {
+        memcpy((uint8_t*)vi_rdram_snapshot + start, rdram8 + start, end - start);
+        memcpy(vi_rdram_hidden_snapshot + (start >> 1), rdram_hidden + (start >> 1), (end - start) >> 1);
+    }
+
+    vi_rdram16 = (uint16_t*)vi_rdram_snapshot;
+    vi_rdram32 = vi_rdram_snapshot;
+    vi_rdram_hidden = vi_rdram_hidden_snapshot;
+}
+
+// sends the frame to the VDAC, it is presented by the next vi_sync call
+static void vi_write(struct frame_buffer* fb)
+{
+    if (!vi_config.stats && !vi_config.trace) {
+        vdac_write(fb);
+        return;
+    }
+
+    uint64_t start = stats_time();
+    vdac_write(fb);
+
+    if (vi_config.stats) {
+        stats_frame.vdac_write += stats_time() - start;
+    }
+
+    if (vi_config.trace) {
+        trace_add(0, "vdac_write", start);
+    }
+}
+
+// presents the frame, which also completes it in the frame statistics
+static void vi_sync(bool invalid)
+{
+    if (!vi_config.stats && !vi_config.trace) {
+        vdac_sync(invalid);
+        return;
+    }
+
+    uint64_t start = stats_time();
+    vdac_sync(invalid);
+
+    if (vi_config.stats) {
+        stats_frame.vdac_sync += stats_time() - start;
+        stats_frame_end();
+    }
+
+    if (vi_config.trace) {
+        trace_add(0, "vdac_sync", start);
+    }
+}
+
+// waits for the frame filtered in the background and sends it to the VDAC,
+// it is presented by the next vi_sync call
+static void vi_pipeline_flush(void)
+{
+    vi_flushed_valid = false;
+
+    if (!vi_pending) {
+        return;
+    }
+
+    if (vi_config.stats) {
+        uint64_t start = stats_time();
+        parallel_wait_async();
+        stats_frame.wait += stats_time() - start;
+    } else {
+        parallel_wait_async();
+    }
+
+    vi_write(&vi_pending_fb);
+    vi_flushed_valid = vi_pending_valid;
+    vi_pending = false;
 }
 
 static bool vi_process_full(void)
@@ -335,7 +797,6 @@ static bool vi_process_full(void)
 
     bool validh = hres > 0 && h_start < PRESCALE_WIDTH;
     int32_t h_end = hres + h_start; // note: the result appears to be different to VI_H_END
-    int32_t hrightblank = PRESCALE_WIDTH - h_end;
 
     if (isblank && prevwasblank) {
         return false;
@@ -346,24 +807,32 @@ static bool vi_process_full(void)
     linecount = PRESCALE_WIDTH << ctrl.serrate;
     prescale_ptr = v_start * linecount + h_start + (lowerfield ? PRESCALE_WIDTH : 0);
 
+    // make room for the rows used by the border clearing, the filters and the
+    // output of the entire prescale area
+    int32_t rows = MAX(vactivelines, (v_start + vres + 1) << ctrl.serrate);
+    prescale_reserve(MAX(rows, (ispal ? V_RES_PAL : V_RES_NTSC) >> !ctrl.serrate));
+
     int32_t i;
     if (isblank) {
         // blank signal, clear entire screen buffer
         memset(tvfadeoutstate, 0, PRESCALE_HEIGHT * sizeof(uint32_t));
-        memset(prescale, 0, sizeof(prescale));
+        for (i = 0; i < prescale_rows; i++) {
+            prescale_clear(i, 0, PRESCALE_WIDTH);
+        }
+        prev_frame_valid = false;
     } else {
         // clear left border
         int32_t j;
         if (h_start > 0 && h_start < PRESCALE_WIDTH) {
             for (i = 0; i < vactivelines; i++) {
-                memset(&prescale[i * PRESCALE_WIDTH], 0, h_start * sizeof(uint32_t));
+                prescale_clear(i, 0, h_start);
             }
         }
 
         // clear right border
         if (h_end >= 0 && h_end < PRESCALE_WIDTH) {
             for (i = 0; i < vactivelines; i++) {
-                memset(&prescale[i * PRESCALE_WIDTH + h_end], 0, hrightblank * sizeof(uint32_t));
+                prescale_clear(i, h_end, PRESCALE_WIDTH);
             }
         }
 
@@ -373,9 +842,9 @@ static bool vi_process_full(void)
                 tvfadeoutstate[i]--;
                 if (!tvfadeoutstate[i]) {
                     if (validh) {
-                        memset(&prescale[i * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                        prescale_clear(i, h_start, h_start + hres);
                     } else {
-                        memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                        prescale_clear(i, 0, PRESCALE_WIDTH);
                     }
                 }
             }
@@ -388,7 +857,7 @@ static bool vi_process_full(void)
                 } else if (tvfadeoutstate[i]) {
                     tvfadeoutstate[i]--;
                     if (!tvfadeoutstate[i]) {
-                        memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                        prescale_clear(i, 0, PRESCALE_WIDTH);
                     }
                 }
 
@@ -401,7 +870,7 @@ static bool vi_process_full(void)
                 } else if (tvfadeoutstate[i]) {
                     tvfadeoutstate[i]--;
                     if (!tvfadeoutstate[i]) {
-                        memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                        prescale_clear(i, 0, PRESCALE_WIDTH);
                     }
                 }
 
@@ -409,9 +878,9 @@ static bool vi_process_full(void)
                     tvfadeoutstate[i + 1]--;
                     if (!tvfadeoutstate[i + 1]) {
                         if (validh) {
-                            memset(&prescale[(i + 1) * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                            prescale_clear(i + 1, h_start, h_start + hres);
                         } else {
-                            memset(&prescale[(i + 1) * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                            prescale_clear(i + 1, 0, PRESCALE_WIDTH);
                         }
                     }
                 }
@@ -427,9 +896,9 @@ static bool vi_process_full(void)
             }
             if (!tvfadeoutstate[i]) {
                 if (validh) {
-                    memset(&prescale[i * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                    prescale_clear(i, h_start, h_start + hres);
                 } else {
-                    memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                    prescale_clear(i, 0, PRESCALE_WIDTH);
                 }
             }
         }
@@ -439,11 +908,52 @@ static bool vi_process_full(void)
         return false;
     }
 
-    // run filter update in parallel if enabled
-    if (config.parallel) {
-        parallel_run(vi_process_full_parallel);
-    } else {
-        vi_process_full_parallel(0);
+    for (i = 0; i < vres; i++) {
+        prescale_mark((prescale_ptr / PRESCALE_WIDTH) + (i << ctrl.serrate), h_start, h_end);
+    }
+
+    // run filter update in parallel if enabled, unless all lines of the
+    // previous frame in the prescale buffer can be reused
+    if (vi_update_dirty_lines()) {
+        uint32_t x_offs = x_start;
+        for (i = 0; i < hres; i++, x_offs += x_add) {
+            vi_column_x[i] = x_offs >> 10;
+            vi_column_frac[i] = (x_offs >> 5) & 0x1f;
+        }
+
+        // the filters only overwrite all channels of the pixels between the
+        // horizontal passes, the alpha of the others is kept
+        int32_t own_start = h_start + minhpass;
+        int32_t own_end = h_start + MAX(MIN(maxhpass, hres), minhpass);
+        for (i = 0; i < vres; i++) {
+            if (vi_line_dirty[i]) {
+                prescale_own((prescale_ptr / PRESCALE_WIDTH) + (i << ctrl.serrate), own_start, own_end);
+
+                if (vi_config.stats) {
+                    stats_frame.vi_rows++;
+                }
+            }
+        }
+
+        if (vi_config.vi.pipelined) {
+            // filter a snapshot of the frame buffer area in the background,
+            // so the RDP can continue with the next frame in the meantime
+            vi_snapshot_rdram();
+            vi_num_workers = 1;
+            parallel_run_async(vi_process_full_async);
+        } else {
+            vi_rdram16 = rdram16;
+            vi_rdram32 = rdram32;
+            vi_rdram_hidden = rdram_hidden;
+
+            if (vi_config.parallel) {
+                vi_num_workers = parallel_num_workers();
+                parallel_run(vi_process_full_parallel);
+            } else {
+                vi_num_workers = 1;
+                vi_process_full_parallel(0);
+            }
+        }
     }
 
     // finish and send buffer to screen
@@ -451,7 +961,7 @@ static bool vi_process_full(void)
     fb.pixels = prescale;
     fb.pitch = PRESCALE_WIDTH;
 
-    if (config.vi.hide_overscan) {
+    if (vi_config.vi.hide_overscan) {
         // crop away overscan area from prescale
         fb.width = maxhpass - minhpass;
         fb.height = vres << ctrl.serrate;
@@ -467,11 +977,30 @@ static bool vi_process_full(void)
     }
 
     // convert to 16:9 if enabled
-    if (config.vi.widescreen) {
+    if (vi_config.vi.widescreen) {
         fb.height_out = fb.height_out * 3 / 4;
     }
 
-    vdac_write(&fb);
+    // bring the lines that weren't filtered in this frame up to date in the
+    // current buffer
+    int32_t fb_row = (int32_t)((fb.pixels - prescale) / PRESCALE_WIDTH);
+    for (i = 0; i < (int32_t)fb.height; i++) {
+        prescale_own(fb_row + i, 0, 0);
+    }
+
+    vi_capture_fb = fb;
+    vi_capture_valid = fb.width > 0 && fb.height > 0;
+
+    if (vi_config.vi.pipelined) {
+        // send this frame on the next update and present the previous frame,
+        // which vi_pipeline_flush has already sent, in the meantime
+        vi_pending_fb = fb;
+        vi_pending_valid = fb.width > 0 && fb.height > 0;
+        vi_pending = true;
+        return vi_flushed_valid;
+    }
+
+    vi_write(&fb);
 
     return fb.width > 0 && fb.height > 0;
 }
@@ -479,9 +1008,7 @@ static bool vi_process_full(void)
 static void vi_process_fast_parallel(uint32_t worker_id)
 {
     int32_t y;
-    int32_t y_begin = 0;
-    int32_t y_end = vres_raw;
-    int32_t y_inc = 1;
+    int32_t y_begin, y_end;
 
     // drop every other interlaced frame to avoid "wobbly" output due to the
     // vertical offset
@@ -491,12 +1018,9 @@ static void vi_process_fast_parallel(uint32_t worker_id)
         return;
     }
 
-    if (config.parallel) {
-        y_begin = worker_id;
-        y_inc = parallel_num_workers();
-    }
+    vi_worker_rows(worker_id, vres_raw, &y_begin, &y_end);
 
-    for (y = y_begin; y < y_end; y += y_inc) {
+    for (y = y_begin; y < y_end; y++) {
         int32_t x;
         int32_t line = y * vi_width_low;
 
@@ -505,7 +1029,7 @@ static void vi_process_fast_parallel(uint32_t worker_id)
         for (x = 0; x < hres_raw; x++) {
             struct rgba* pixel = &pixel_row[x];
 
-            switch (config.vi.mode) {
+            switch (vi_config.vi.mode) {
                 case VI_MODE_COLOR:
                     switch (ctrl.type) {
                         case VI_TYPE_RGBA5551: {
@@ -571,10 +1095,33 @@ static bool vi_process_fast(void)
         return false;
     }
 
+    // prescale is used with a different layout here
+    prev_frame_valid = false;
+
+    // the frame is shifted by one pixel when it's presented, so the buffer
+    // needs room for one pixel more
+    int32_t i;
+    int32_t rows = (hres_raw * vres_raw + PRESCALE_WIDTH) / PRESCALE_WIDTH;
+    prescale_reserve(rows);
+
+    // the pixels keep their alpha and aren't written at all for some frames,
+    // so the rows are carried over completely
+    for (i = 0; i < rows; i++) {
+        prescale_own(i, 0, 0);
+        prescale_mark(i, 0, PRESCALE_WIDTH);
+    }
+
+    // the workers skip every other interlaced frame
+    if (vi_config.stats && !(ctrl.serrate && v_current_line)) {
+        stats_frame.vi_rows += vres_raw;
+    }
+
     // run filter update in parallel if enabled
-    if (config.parallel) {
+    if (vi_config.parallel) {
+        vi_num_workers = parallel_num_workers();
         parallel_run(vi_process_fast_parallel);
     } else {
+        vi_num_workers = 1;
         vi_process_fast_parallel(0);
     }
 
@@ -598,11 +1145,14 @@ static bool vi_process_fast(void)
     fb.height_out = fb.width * filtered_height / filtered_width;
 
     // convert to 16:9 if enabled
-    if (config.vi.widescreen) {
+    if (vi_config.vi.widescreen) {
         fb.height_out = fb.height_out * 3 / 4;
     }
 
-    vdac_write(&fb);
+    vi_capture_fb = fb;
+    vi_capture_valid = fb.width > 0 && fb.height > 0;
+
+    vi_write(&fb);
 
     return fb.width > 0 && fb.height > 0;
 }
@@ -614,13 +1164,20 @@ void vi_set_zbuffer_address(uint32_t address)
 
 void n64video_update_screen(void)
 {
+    // finish the previous frame if it was filtered in the background. it is
+    // dropped unless this frame is queued for filtering as well
+    vi_pipeline_flush();
+
+    // there's nothing to capture until this frame has been filtered
+    vi_capture_valid = false;
+
     // check for configuration errors
-    if (config.vi.mode >= VI_MODE_NUM) {
-        msg_error("Invalid VI mode: %d", config.vi.mode);
+    if (vi_config.vi.mode >= VI_MODE_NUM) {
+        msg_error("Invalid VI mode: %d", vi_config.vi.mode);
     }
 
     // parse and check some common registers
-    vi_reg_ptr = config.gfx.vi_reg;
+    vi_reg_ptr = vi_config.gfx.vi_reg;
 
     v_start = (*vi_reg_ptr[VI_V_START] >> 16) & 0x3ff;
     h_start = (*vi_reg_ptr[VI_H_START] >> 16) & 0x3ff;
@@ -645,12 +1202,12 @@ void n64video_update_screen(void)
 
     // cancel if the frame buffer contains no valid address
     if (!frame_buffer) {
-        vdac_sync(true);
+        vi_sync(true);
         return;
     }
 
     // split up VI_CONTROL bits
-    uint32_t vi_control = *vi_reg_ptr[VI_STATUS];
+    vi_control = *vi_reg_ptr[VI_STATUS];
     ctrl.type = vi_control & 3;
     ctrl.gamma_dither_enable = (vi_control >> 2) & 1;
     ctrl.gamma_enable = (vi_control >> 3) & 1;
@@ -671,22 +1228,22 @@ void n64video_update_screen(void)
 
     // warn about AA glitches in certain cases
     if (ctrl.aa_mode == VI_AA_REPLICATE && ctrl.type == VI_TYPE_RGBA5551 &&
-        h_start < 0x80 && x_add <= 0x200 && !onetimewarnings.nolerp) {
+        h_start < 0x80 && x_add <= 0x200 && !vi_onetimewarnings.nolerp) {
         msg_warning("vi_update: Disabling VI interpolation in 16-bit color "
                     "modes causes glitches on hardware if h_start is less than "
                     "128 pixels and x_scale is less or equal to 0x200.");
-        onetimewarnings.nolerp = true;
+        vi_onetimewarnings.nolerp = true;
     }
 
     // check for the dangerous vbus_clock_enable flag. it was introduced to
     // configure Ultra 64 prototypes and enabling it on final hardware will
     // enable two output drivers on the same bus at the same time
-    if (ctrl.vbus_clock_enable && !onetimewarnings.vbusclock) {
+    if (ctrl.vbus_clock_enable && !vi_onetimewarnings.vbusclock) {
         msg_warning("vi_update: vbus_clock_enable bit set in VI_CONTROL_REG "
                     "register. Never run this code on your N64! It's rumored "
                     "that turning this bit on will result in permanent damage "
                     "to the hardware! Emulation will now continue.");
-        onetimewarnings.vbusclock = true;
+        vi_onetimewarnings.vbusclock = true;
     }
 
     // adjust sizes and offsets
@@ -738,21 +1295,69 @@ void n64video_update_screen(void)
         minhpass = h_start_clamped ? 0 : 8;
         maxhpass = hres_clamped ? hres : (hres - 7);
 
+        uint64_t start = vi_config.stats || vi_config.trace ? stats_time() : 0;
+        uint64_t write_time = stats_frame.vdac_write;
+
         // run filter update in parallel if enabled
-        if (config.vi.mode == VI_MODE_NORMAL) {
+        if (vi_config.vi.mode == VI_MODE_NORMAL) {
             valid = vi_process_full();
         } else {
             valid = vi_process_fast();
         }
+
+        if (vi_config.stats) {
+            stats_frame.vi += stats_time() - start - (stats_frame.vdac_write - write_time);
+        }
+
+        if (vi_config.trace) {
+            trace_add(0, vi_config.vi.mode == VI_MODE_NORMAL ? "vi_process_full" : "vi_process_fast", start);
+        }
     }
 
     // render frame to screen or blank screen if the frame is invalid
-    vdac_sync(!valid);
+    vi_sync(!valid);
+}
+
+void n64video_read_screen(struct frame_buffer* fb, bool alpha)
+{
+    // the last frame may still be filtered in the background
+    parallel_wait_async();
+
+    if (!vi_capture_valid) {
+        fb->width = 0;
+        fb->height = 0;
+        fb->pitch = 0;
+        return;
+    }
+
+    // keep the size that vdac_read returns, which is the viewport on the
+    // screen, so captures look the same as the frame that is shown
+    struct frame_buffer size = { 0 };
+    vdac_read(&size, alpha);
+    fb->width = size.width;
+    fb->height = size.height;
+
+    vdac_copy(fb, &vi_capture_fb, alpha);
 }
 
-static void vi_close(void)
+void vi_close(void)
 {
+    parallel_wait_async();
+
+    if (!prescale_mapped) {
+        free(prescale);
+    }
+    free(prescale_ranges);
+    free(vi_rdram_snapshot);
+    free(vi_rdram_hidden_snapshot);
+    prescale = NULL;
+    prescale_buffer = 0;
+    prescale_mapped = false;
+    vi_capture_valid = false;
+    prescale_ranges = NULL;
+    prescale_rows = 0;
+    vi_rdram_snapshot = NULL;
+    vi_rdram_hidden_snapshot = NULL;
     vdac_close();
 }
 
-#endif // N64VIDEO_C
@@ -1,4 +1,4 @@
-#ifdef N64VIDEO_C
+#ifdef N64VIDEO_VI_C
 
 static STRICTINLINE void divot_filter(struct rgba* final, struct rgba center, struct rgba left, struct rgba right)
 {
@@ -25,5 +25,5 @@ static STRICTINLINE void divot_filter(struct rgba* final, struct rgba center, st
         final->b = right.b;
 }
 
-#endif // N64VIDEO_C
+#endif // N64VIDEO_VI_C
 
@@ -1,4 +1,4 @@
-#ifdef N64VIDEO_C
+#ifdef N64VIDEO_VI_C
 
 static void vi_fetch_filter16(struct rgba* res, uint32_t fboffset, uint32_t cur_x, struct vi_reg_ctrl ctrl, uint32_t hres, uint32_t fetchstate)
 {
@@ -9,12 +9,12 @@ static void vi_fetch_filter16(struct rgba* res, uint32_t fboffset, uint32_t cur_
     uint32_t cur_cvg;
     if (ctrl.aa_mode <= VI_AA_RESAMP_EXTRA)
     {
-        PAIRREAD16(pix, hval, idx);
+        vi_rdram_read_pair16(&pix, &hval, idx);
         cur_cvg = ((pix & 1) << 2) | hval;
     }
     else
     {
-        RREADIDX16(pix, idx);
+        pix = vi_rdram_read_idx16(idx);
         cur_cvg = 7;
     }
     r = RGBA16_R(pix);
@@ -42,7 +42,7 @@ static void vi_fetch_filter32(struct rgba* res, uint32_t fboffset, uint32_t cur_
 {
     int r, g, b;
     uint32_t pix, addr = (fboffset >> 2) + cur_x;
-    RREADIDX32(pix, addr);
+    pix = vi_rdram_read_idx32(addr);
     uint32_t cur_cvg;
     if (ctrl.aa_mode <= VI_AA_RESAMP_EXTRA)
         cur_cvg = (pix >> 5) & 7;
@@ -68,5 +68,5 @@ static void vi_fetch_filter32(struct rgba* res, uint32_t fboffset, uint32_t cur_
     res->a = cur_cvg;
 }
 
-#endif // N64VIDEO_C
+#endif // N64VIDEO_VI_C
 
@@ -1,4 +1,4 @@
-#ifdef N64VIDEO_C
+#ifdef N64VIDEO_VI_C
 
 static uint8_t gamma_table[0x100];
 static uint8_t gamma_dither_table[0x4000];
@@ -60,6 +60,76 @@ static STRICTINLINE void gamma_filters(struct rgba* pixel, bool gamma_enable, bo
     }
 }
 
+// same as gamma_filters for a whole row of pixels, with the dither noise for
+// the row generated up front
+static STRICTINLINE void gamma_filters_row(struct rgba* pixels, int32_t count, bool gamma_enable, bool gamma_dither_enable, uint32_t* rstate)
+{
+    int32_t i = 0;
+    int cdith, dith;
+    uint32_t noise[PRESCALE_WIDTH];
+
+    if (count <= 0) {
+        return;
+    }
+
+    switch((gamma_enable << 1) | gamma_dither_enable)
+    {
+    case 0: // no gamma, no dithering
+        return;
+    case 1: // no gamma, dithering enabled
+        irand_bulk(rstate, noise, count);
+#ifdef HAVE_SSE2
+        // adding the dither bits with unsigned saturation leaves components
+        // at 255 unchanged
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i n = _mm_srli_epi32(_mm_loadu_si128((__m128i*)&noise[i]), 16);
+            __m128i dr = _mm_and_si128(n, _mm_set1_epi32(0x1));
+            __m128i dg = _mm_and_si128(_mm_slli_epi32(n, 7), _mm_set1_epi32(0x100));
+            __m128i db = _mm_and_si128(_mm_slli_epi32(n, 14), _mm_set1_epi32(0x10000));
+            __m128i pix = _mm_loadu_si128((__m128i*)&pixels[i]);
+            pix = _mm_adds_epu8(pix, _mm_or_si128(dr, _mm_or_si128(dg, db)));
+            _mm_storeu_si128((__m128i*)&pixels[i], pix);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            cdith = (noise[i] >> 16) & 0x7fff;
+            dith = cdith & 1;
+            if (pixels[i].r < 255)
+                pixels[i].r += dith;
+            dith = (cdith >> 1) & 1;
+            if (pixels[i].g < 255)
+                pixels[i].g += dith;
+            dith = (cdith >> 2) & 1;
+            if (pixels[i].b < 255)
+                pixels[i].b += dith;
+        }
+        break;
+    case 2: // gamma enabled, no dithering
+        for (; i < count; i++)
+        {
+            pixels[i].r = gamma_table[pixels[i].r];
+            pixels[i].g = gamma_table[pixels[i].g];
+            pixels[i].b = gamma_table[pixels[i].b];
+        }
+        break;
+    case 3: // gamma and dithering enabled
+        irand_bulk(rstate, noise, count);
+        for (; i < count; i++)
+        {
+            cdith = (noise[i] >> 16) & 0x7fff;
+            dith = cdith & 0x3f;
+            pixels[i].r = gamma_dither_table[((pixels[i].r) << 6)|dith];
+            dith = (cdith >> 6) & 0x3f;
+            pixels[i].g = gamma_dither_table[((pixels[i].g) << 6)|dith];
+            dith = ((cdith >> 9) & 0x38) | (cdith & 7);
+            pixels[i].b = gamma_dither_table[((pixels[i].b) << 6)|dith];
+        }
+        break;
+    }
+}
+
 void vi_gamma_init(void)
 {
     int i;
@@ -76,4 +146,4 @@ void vi_gamma_init(void)
     }
 }
 
-#endif // N64VIDEO_C
+#endif // N64VIDEO_VI_C
@@ -1,4 +1,4 @@
-#ifdef N64VIDEO_C
+#ifdef N64VIDEO_VI_C
 
 static STRICTINLINE void vi_vl_lerp(struct rgba* up, struct rgba down, uint32_t frac)
 {
@@ -15,4 +15,4 @@ static STRICTINLINE void vi_vl_lerp(struct rgba* up, struct rgba down, uint32_t
     up->b = ((((down.b - b0) * frac + 16) >> 5) + b0) & 0xff;
 }
 
-#endif // N64VIDEO_C
+#endif // N64VIDEO_VI_C
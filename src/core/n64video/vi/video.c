@@ -1,4 +1,4 @@
-#ifdef N64VIDEO_C
+#ifdef N64VIDEO_VI_C
 
 static STRICTINLINE void video_max_optimized(uint32_t* pixels, uint32_t* penumin, uint32_t* penumax, int numofels)
 {
@@ -42,11 +42,50 @@ static STRICTINLINE void video_max_optimized(uint32_t* pixels, uint32_t* penumin
     *penumin = curpenmin;
 }
 
+// finds the penultimate minimum and maximum of all three color channels at
+// once with the same results as video_max_optimized. if the first pixel is
+// the extreme of a channel, it is also the penultimate value, otherwise it's
+// the second extreme of all pixels, counting duplicates
+static STRICTINLINE void video_max_optimized_rgb(uint32_t* backr, uint32_t* backg, uint32_t* backb, uint32_t* penumin, uint32_t* penumax, int numofels)
+{
+#ifdef HAVE_SSE2
+    int i;
+    __m128i first = _mm_setr_epi16(backr[0], backg[0], backb[0], 0, 0, 0, 0, 0);
+    __m128i max = first, min = first;
+    __m128i penmax = _mm_setzero_si128();
+    __m128i penmin = _mm_set1_epi16(0x7fff);
+
+    for (i = 1; i < numofels; i++)
+    {
+        __m128i pix = _mm_setr_epi16(backr[i], backg[i], backb[i], 0, 0, 0, 0, 0);
+        penmax = _mm_max_epi16(penmax, _mm_min_epi16(max, pix));
+        penmin = _mm_min_epi16(penmin, _mm_max_epi16(min, pix));
+        max = _mm_max_epi16(max, pix);
+        min = _mm_min_epi16(min, pix);
+    }
+
+    __m128i firstmax = _mm_cmpeq_epi16(first, max);
+    __m128i firstmin = _mm_cmpeq_epi16(first, min);
+    penmax = _mm_or_si128(_mm_and_si128(firstmax, max), _mm_andnot_si128(firstmax, penmax));
+    penmin = _mm_or_si128(_mm_and_si128(firstmin, min), _mm_andnot_si128(firstmin, penmin));
+
+    penumax[0] = _mm_extract_epi16(penmax, 0);
+    penumax[1] = _mm_extract_epi16(penmax, 1);
+    penumax[2] = _mm_extract_epi16(penmax, 2);
+    penumin[0] = _mm_extract_epi16(penmin, 0);
+    penumin[1] = _mm_extract_epi16(penmin, 1);
+    penumin[2] = _mm_extract_epi16(penmin, 2);
+#else
+    video_max_optimized(backr, &penumin[0], &penumax[0], numofels);
+    video_max_optimized(backg, &penumin[1], &penumax[1], numofels);
+    video_max_optimized(backb, &penumin[2], &penumax[2], numofels);
+#endif
+}
 
 static STRICTINLINE void video_filter16(int* endr, int* endg, int* endb, uint32_t fboffset, uint32_t num, uint32_t hres, uint32_t centercvg, uint32_t fetchbugstate)
 {
     int i;
-    uint32_t penumaxr, penumaxg, penumaxb, penuminr, penuming, penuminb;
+    uint32_t penumax[3], penumin[3];
     uint16_t pix;
     uint32_t numoffull = 1;
     uint8_t hidval;
@@ -86,7 +125,7 @@ static STRICTINLINE void video_filter16(int* endr, int* endg, int* endb, uint32_
 
     for (i = 0; i < 6; i++)
     {
-        rdram_read_pair16(&pix, &hidval, dirs[i]);
+        vi_rdram_read_pair16(&pix, &hidval, dirs[i]);
         if (hidval == 3 && (pix & 1))
         {
             backr[numoffull] = RGBA16_R(pix);
@@ -98,14 +137,12 @@ static STRICTINLINE void video_filter16(int* endr, int* endg, int* endb, uint32_
 
     uint32_t colr, colg, colb;
 
-    video_max_optimized(backr, &penuminr, &penumaxr, numoffull);
-    video_max_optimized(backg, &penuming, &penumaxg, numoffull);
-    video_max_optimized(backb, &penuminb, &penumaxb, numoffull);
+    video_max_optimized_rgb(backr, backg, backb, penumin, penumax, numoffull);
 
     uint32_t coeff = 7 - centercvg;
-    colr = penuminr + penumaxr - (r << 1);
-    colg = penuming + penumaxg - (g << 1);
-    colb = penuminb + penumaxb - (b << 1);
+    colr = penumin[0] + penumax[0] - (r << 1);
+    colg = penumin[1] + penumax[1] - (g << 1);
+    colb = penumin[2] + penumax[2] - (b << 1);
 
     colr = (((colr * coeff) + 4) >> 3) + r;
     colg = (((colg * coeff) + 4) >> 3) + g;
@@ -119,7 +156,7 @@ static STRICTINLINE void video_filter16(int* endr, int* endg, int* endb, uint32_
 static STRICTINLINE void video_filter32(int* endr, int* endg, int* endb, uint32_t fboffset, uint32_t num, uint32_t hres, uint32_t centercvg, uint32_t fetchbugstate)
 {
     int i;
-    uint32_t penumaxr, penumaxg, penumaxb, penuminr, penuming, penuminb;
+    uint32_t penumax[3], penumin[3];
     uint32_t numoffull = 1;
     uint32_t pix = 0, pixcvg = 0;
     uint32_t r, g, b;
@@ -158,7 +195,7 @@ static STRICTINLINE void video_filter32(int* endr, int* endg, int* endb, uint32_
 
     for (i = 0; i < 6; i++)
     {
-        pix = rdram_read_idx32(dirs[i]);
+        pix = vi_rdram_read_idx32(dirs[i]);
         pixcvg = (pix >> 5) & 7;
         if (pixcvg == 7)
         {
@@ -171,14 +208,12 @@ static STRICTINLINE void video_filter32(int* endr, int* endg, int* endb, uint32_
 
     uint32_t colr, colg, colb;
 
-    video_max_optimized(backr, &penuminr, &penumaxr, numoffull);
-    video_max_optimized(backg, &penuming, &penumaxg, numoffull);
-    video_max_optimized(backb, &penuminb, &penumaxb, numoffull);
+    video_max_optimized_rgb(backr, backg, backb, penumin, penumax, numoffull);
 
     uint32_t coeff = 7 - centercvg;
-    colr = penuminr + penumaxr - (r << 1);
-    colg = penuming + penumaxg - (g << 1);
-    colb = penuminb + penumaxb - (b << 1);
+    colr = penumin[0] + penumax[0] - (r << 1);
+    colg = penumin[1] + penumax[1] - (g << 1);
+    colb = penumin[2] + penumax[2] - (b << 1);
 
     colr = (((colr * coeff) + 4) >> 3) + r;
     colg = (((colg * coeff) + 4) >> 3) + g;
@@ -189,4 +224,4 @@ static STRICTINLINE void video_filter32(int* endr, int* endg, int* endb, uint32_
     *endb = colb & 0xff;
 }
 
-#endif // N64VIDEO_C
+#endif // N64VIDEO_VI_C
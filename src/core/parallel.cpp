@@ -4,26 +4,142 @@
 #include <algorithm>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <fstream>
+#include <sched.h>
+#include <string>
+#endif
+
+#ifdef __linux__
+// parses a sysfs CPU or node list such as "0-3,8-11"
+static std::vector<int> read_cpu_list(const std::string& path)
+{
+    std::vector<int> list;
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line)) {
+        return list;
+    }
+
+    std::size_t pos = 0;
+    while (pos < line.size()) {
+        std::size_t end = line.find(',', pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+
+        std::string range = line.substr(pos, end - pos);
+        if (!range.empty()) {
+            std::size_t dash = range.find('-');
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int i = first; i <= last; i++) {
+                list.push_back(i);
+            }
+        }
+
+        pos = end + 1;
+    }
+
+    return list;
+}
+
+// returns the CPUs the workers should be pinned to, grouped by NUMA node and
+// starting with the node and CPU of the calling thread
+static std::vector<int> numa_cpu_order()
+{
+    std::vector<int> order;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        return order;
+    }
+
+    const std::string node_path = "/sys/devices/system/node/";
+    std::vector<int> nodes = read_cpu_list(node_path + "online");
+
+    // without NUMA support in the kernel, treat the system as a single node
+    if (nodes.empty()) {
+        nodes.push_back(-1);
+    }
+
+    std::vector<std::vector<int>> node_cpus;
+    int home_cpu = sched_getcpu();
+    std::size_t home_node = 0;
+
+    for (int node : nodes) {
+        std::vector<int> cpus;
+        if (node < 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } else {
+            cpus = read_cpu_list(node_path + "node" + std::to_string(node) + "/cpulist");
+        }
+
+        // respect the affinity mask of the process, other instances might be
+        // sharing the host
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&allowed](int cpu) {
+            return cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed);
+        }), cpus.end());
+
+        if (cpus.empty()) {
+            continue;
+        }
+
+        // worker 0 runs in the calling thread, so its CPU comes first
+        auto home = std::find(cpus.begin(), cpus.end(), home_cpu);
+        if (home != cpus.end()) {
+            std::rotate(cpus.begin(), home, cpus.end());
+            home_node = node_cpus.size();
+        }
+
+        node_cpus.push_back(cpus);
+    }
+
+    // fill the home node first before spilling over to remote nodes
+    for (std::size_t i = 0; i < node_cpus.size(); i++) {
+        auto& cpus = node_cpus[(home_node + i) % node_cpus.size()];
+        order.insert(order.end(), cpus.begin(), cpus.end());
+    }
+
+    return order;
+}
+#endif
+
 class Parallel
 {
 public:
-    Parallel(std::uint32_t num_workers)
+    Parallel(std::uint32_t num_workers, bool affinity)
     {
         if (num_workers == 0) {
-            // auto-select number of workers based on the number of cores
-            m_num_workers = std::thread::hardware_concurrency();
-        } else {
-            m_num_workers = std::min(num_workers, PARALLEL_MAX_WORKERS);
+            // auto-select number of workers based on the number of cores,
+            // which may be unknown
+            num_workers = std::max(std::thread::hardware_concurrency(), 1u);
         }
 
+        // hosts with more cores than that are limited to one worker per bit
+        // of m_tasks_done
+        m_num_workers = std::min(num_workers, PARALLEL_MAX_WORKERS);
+
         // mask for m_tasks_done when all workers have finished their task
-        // except for worker 0, which runs in the main thread
-        m_all_tasks_done = (1LL << m_num_workers) - 2;
+        // except for worker 0, which runs in the main thread. shifting by 64
+        // is undefined, so the full mask wraps around from 0 instead
+        m_all_tasks_done = (m_num_workers < 64 ? 1ULL << m_num_workers : 0) - 2;
+
+#ifdef __linux__
+        // select CPUs for workers if they should be pinned
+        if (affinity) {
+            m_cpus = numa_cpu_order();
+        }
+#endif
 
         // give workers an empty task
         m_task = [](std::uint32_t) {};
@@ -87,6 +203,7 @@ private:
     std::uint64_t m_all_tasks_done;
     std::atomic<bool> m_accept_work;
     std::uint32_t m_num_workers;
+    std::vector<int> m_cpus;
 
     void start_work() {
         std::unique_lock<std::mutex> ul(m_signal_mutex);
@@ -98,8 +215,25 @@ private:
         m_signal_work.notify_all();
     }
 
+    void pin_worker(std::uint32_t worker_id) {
+#ifdef __linux__
+        if (m_cpus.empty()) {
+            return;
+        }
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(m_cpus[worker_id % m_cpus.size()], &mask);
+        sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+    }
+
     void do_work(std::uint32_t worker_id) {
-        const std::uint64_t worker_mask = 1LL << worker_id;
+        const std::uint64_t worker_mask = 1ULL << worker_id;
+
+        // pin before running the first task so that all memory touched by
+        // this worker is allocated on its own node
+        pin_worker(worker_id);
 
         while (m_accept_work) {
             // do the work
@@ -134,12 +268,87 @@ private:
     Parallel(const Parallel&) = delete;
 };
 
-// C interface for the Parallel class
+// single background thread that runs one task at a time next to the workers
+class Async
+{
+public:
+    Async() : m_busy(false), m_exit(false)
+    {
+        m_thread = std::thread(&Async::do_work, this);
+    }
+
+    ~Async() {
+        // finish the current task before exiting
+        wait();
+
+        {
+            std::unique_lock<std::mutex> ul(m_signal_mutex);
+            m_exit = true;
+            m_signal_work.notify_one();
+        }
+
+        m_thread.join();
+    }
+
+    void run(std::function<void()>&& task) {
+        // only one task can be in flight
+        wait();
+
+        std::unique_lock<std::mutex> ul(m_signal_mutex);
+        m_task = task;
+        m_busy = true;
+        m_signal_work.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> ul(m_signal_mutex);
+        m_signal_done.wait(ul, [this] {
+            return !m_busy;
+        });
+    }
+
+private:
+    std::function<void()> m_task;
+    std::thread m_thread;
+    std::mutex m_signal_mutex;
+    std::condition_variable m_signal_work;
+    std::condition_variable m_signal_done;
+    bool m_busy;
+    bool m_exit;
+
+    void do_work() {
+        std::unique_lock<std::mutex> ul(m_signal_mutex);
+
+        while (true) {
+            m_signal_work.wait(ul, [this] {
+                return m_busy || m_exit;
+            });
+
+            if (m_exit) {
+                break;
+            }
+
+            // run the task without holding the lock so it can be waited for
+            ul.unlock();
+            m_task();
+            ul.lock();
+
+            m_busy = false;
+            m_signal_done.notify_all();
+        }
+    }
+
+    void operator=(const Async&) = delete;
+    Async(const Async&) = delete;
+};
+
+// C interface for the Parallel and Async classes
 static std::unique_ptr<Parallel> parallel;
+static std::unique_ptr<Async> async;
 
-void parallel_init(uint32_t num)
+void parallel_init(uint32_t num, bool affinity)
 {
-    parallel = std::make_unique<Parallel>(num);
+    parallel = std::make_unique<Parallel>(num, affinity);
 }
 
 void parallel_run(void task(uint32_t))
@@ -152,7 +361,25 @@ uint32_t parallel_num_workers()
     return parallel->num_workers();
 }
 
+void parallel_run_async(void task(void))
+{
+    // the thread is only started when it is needed for the first time
+    if (!async) {
+        async = std::make_unique<Async>();
+    }
+
+    async->run(task);
+}
+
+void parallel_wait_async()
+{
+    if (async) {
+        async->wait();
+    }
+}
+
 void parallel_close()
 {
+    async.reset();
     parallel.reset();
 }
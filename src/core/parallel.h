@@ -5,12 +5,15 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define PARALLEL_MAX_WORKERS 64u
 
-void parallel_init(uint32_t num);
+void parallel_init(uint32_t num, bool affinity);
 void parallel_run(void task(uint32_t));
 uint32_t parallel_num_workers();
+void parallel_run_async(void task(void));
+void parallel_wait_async();
 void parallel_close();
 
 #ifdef __cplusplus
@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 struct rgba
 {
@@ -22,8 +23,39 @@ struct frame_buffer
     uint32_t pitch;
 };
 
+// output backend, which is selected by vdac_init
+struct vdac_backend
+{
+    void (*init)(struct n64video_config* config);
+    void (*read)(struct frame_buffer* fb, bool alpha);
+    void (*write)(struct frame_buffer* fb);
+    uint32_t (*map)(size_t size, struct rgba** buffers, uint32_t* index);
+    void (*sync)(bool invalid);
+    void (*close)(void);
+};
+
+// OpenGL output to the screen of the plugin
+extern const struct vdac_backend vdac_gl;
+// headless output to the frame callback of the config
+extern const struct vdac_backend vdac_sink;
+
 void vdac_init(struct n64video_config* config);
 void vdac_read(struct frame_buffer* fb, bool alpha);
+// maximum number of staging buffers a backend can have
+#define VDAC_MAP_MAX 4
+
+// maps the staging buffers that frames can be filtered into directly, each
+// with room for at least size pixels, to buffers and returns their number, or
+// 0 if the caller has to provide its own memory. the next frame has to be
+// written to the buffer at index, which isn't read by the GPU anymore. the
+// buffers are used in turns, so it doesn't hold the previous frame, but each
+// keeps its contents between calls, also when it grows. they must be mapped
+// again before each frame is written.
+uint32_t vdac_map(size_t size, struct rgba** buffers, uint32_t* index);
 void vdac_write(struct frame_buffer* fb);
 void vdac_sync(bool invaid);
 void vdac_close(void);
+// copies a frame to the packed RGBA or RGB buffer of dst, if set, in the
+// format of vdac_read. it is scaled to the size of dst if that is set, else
+// it is stretched to the output height and the size of dst is set to that
+void vdac_copy(struct frame_buffer* dst, const struct frame_buffer* src, bool alpha);
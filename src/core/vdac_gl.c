@@ -0,0 +1,512 @@
+#include "vdac.h"
+#include "screen.h"
+#include "msg.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef GLES
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#define SHADER_HEADER "#version 300 es\nprecision lowp float;\n"
+#elif defined(OGLES)
+#import <OpenGLES/ES3/gl.h>
+#define SHADER_HEADER "#version 300 es\nprecision lowp float;\n"
+#else
+#import <OpenGLES/ES3/gl.h>
+#import <OpenGLES/ES3/glext.h>
+//#include "gl_core_3_3.h"
+#define SHADER_HEADER "precision lowp float;\n"
+#endif
+
+#define TEX_FORMAT GL_RGBA
+#define TEX_TYPE GL_UNSIGNED_BYTE
+
+// persistently mapped pixel buffers need buffer storage, which is an
+// extension on OpenGL ES 3. its function is loaded at runtime, since the
+// headers only declare it if GL_GLEXT_PROTOTYPES is set and the GL library
+// doesn't have to export it
+#ifdef GL_EXT_buffer_storage
+#define HAVE_PBO_STORAGE
+void* IntGetProcAddress(const char *name);
+#endif
+
+static GLuint program;
+static GLuint vao;
+static GLuint texture;
+
+static int32_t tex_width;
+static int32_t tex_height;
+static int32_t tex_pitch;
+
+static int32_t tex_height_out;
+
+#ifdef HAVE_PBO_STORAGE
+// number of staging buffers, so that the VI can filter into one while the
+// uploads from the others are still pending
+#define PBO_NUM 3
+
+// staging buffers that the VI filters into, which are uploaded to the
+// texture without a copy on the CPU side
+static bool pbo_supported;
+static GLuint pbo[PBO_NUM];
+static struct rgba* pbo_pixels[PBO_NUM];
+static GLsync pbo_fence[PBO_NUM];
+static size_t pbo_size;
+static uint32_t pbo_index;
+static PFNGLBUFFERSTORAGEEXTPROC ptr_glBufferStorageEXT;
+#endif
+
+#ifdef _DEBUG
+static void gl_check_errors(void)
+{
+    GLenum err;
+    static int32_t invalid_op_count = 0;
+    while ((err = glGetError()) != GL_NO_ERROR) {
+        // if gl_check_errors is called from a thread with no valid
+        // GL context, it would be stuck in an infinite loop here, since
+        // glGetError itself causes GL_INVALID_OPERATION, so check for a few
+        // cycles and abort if there are too many errors of that kind
+        if (err == GL_INVALID_OPERATION) {
+            if (++invalid_op_count >= 100) {
+                msg_error("gl_check_errors: invalid OpenGL context!");
+            }
+        } else {
+            invalid_op_count = 0;
+        }
+
+        char* err_str;
+        switch (err) {
+            case GL_INVALID_OPERATION:
+                err_str = "INVALID_OPERATION";
+                break;
+            case GL_INVALID_ENUM:
+                err_str = "INVALID_ENUM";
+                break;
+            case GL_INVALID_VALUE:
+                err_str = "INVALID_VALUE";
+                break;
+            case GL_OUT_OF_MEMORY:
+                err_str = "OUT_OF_MEMORY";
+                break;
+            case GL_INVALID_FRAMEBUFFER_OPERATION:
+                err_str = "INVALID_FRAMEBUFFER_OPERATION";
+                break;
+            default:
+                err_str = "unknown";
+        }
+        msg_debug("gl_check_errors: %d (%s)", err, err_str);
+    }
+}
+#else
+#define gl_check_errors(...)
+#endif
+
+static bool gl_shader_load_file(GLuint shader, const char* path)
+{
+    bool success = false;
+    GLchar* source = NULL;
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        // fail quietly
+        goto end;
+    }
+
+    // get file size
+    fseek(fp, 0, SEEK_END);
+    uint32_t source_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    // allocate buffer for shader code
+    source = malloc(source_size + 1);
+    if (source == NULL) {
+        msg_error("Can't allocate memory for shader file %s", path);
+        goto end;
+    }
+
+    // read shader code
+    if (fread(source, source_size, 1, fp) != 1) {
+        msg_warning("Can't read shader file %s", path);
+        goto end;
+    }
+
+    // terminate shader code string
+    source[source_size] = 0;
+
+    // send string to OpenGL
+    const GLchar* source_ptr = source;
+    glShaderSource(shader, 1, &source_ptr, NULL);
+
+    success = true;
+
+end:
+    if (fp) {
+        fclose(fp);
+    }
+    if (source) {
+        free(source);
+    }
+
+    return success;
+}
+
+static GLuint gl_shader_compile(GLenum type, const GLchar* source, const char* path)
+{
+    GLuint shader = glCreateShader(type);
+
+    // try to load external shader file first, otherwise use embedded fallback shader
+    if (!gl_shader_load_file(shader, path)) {
+        glShaderSource(shader, 1, &source, NULL);
+    }
+
+    glCompileShader(shader);
+
+    GLint param;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &param);
+
+    if (!param) {
+        GLchar log[4096];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        msg_error("%s shader error: %s\n", type == GL_FRAGMENT_SHADER ? "Frag" : "Vert", log);
+        return 0;
+    }
+
+    return shader;
+}
+
+static GLuint gl_shader_link(GLuint vert, GLuint frag)
+{
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vert);
+    glAttachShader(program, frag);
+    glLinkProgram(program);
+
+    GLint param;
+    glGetProgramiv(program, GL_LINK_STATUS, &param);
+
+    if (!param) {
+        GLchar log[4096];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        msg_error("Shader link error: %s\n", log);
+    }
+
+    glDeleteShader(frag);
+    glDeleteShader(vert);
+
+    return program;
+}
+
+static void gl_init(struct n64video_config* config)
+{
+    screen_init(config);
+
+#ifndef GLES
+    // load OpenGL function pointers
+//    ogl_LoadFunctions();
+#endif
+
+    msg_debug("%s: GL_VERSION='%s'", __FUNCTION__, glGetString(GL_VERSION));
+    msg_debug("%s: GL_VENDOR='%s'", __FUNCTION__, glGetString(GL_VENDOR));
+    msg_debug("%s: GL_RENDERER='%s'", __FUNCTION__, glGetString(GL_RENDERER));
+    msg_debug("%s: GL_SHADING_LANGUAGE_VERSION='%s'", __FUNCTION__, glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+//    // shader sources for drawing a clipped full-screen triangle. the geometry
+//    // is defined by the vertex ID, so a VBO is not required.
+//    const GLchar* vert_shader =
+//        SHADER_HEADER
+//        "varying vec2 uv;\n"
+//        "void main(void) {\n"
+//        "    uv = vec2(1.0, 1.0);\n"
+//        "    gl_Position = vec4(uv * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+//        "}\n";
+//
+//    const GLchar* frag_shader =
+//        SHADER_HEADER
+//        "attribute vec2 uv;\n"
+//        "layout(location = 0) varying vec4 color;\n"
+//        "uniform sampler2D tex0;\n"
+//        "void main(void) {\n"
+//        "    color = texture(tex0, uv);\n"
+//        "}\n";
+//
+//    // compile and link OpenGL program
+//    GLuint vert = gl_shader_compile(GL_VERTEX_SHADER, vert_shader, "alp_screen.vert");
+//    GLuint frag = gl_shader_compile(GL_FRAGMENT_SHADER, frag_shader, "alp_screen.frag");
+//    program = gl_shader_link(vert, frag);
+//    glUseProgram(program);
+
+    // prepare dummy VAO
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // prepare texture
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // select interpolation method
+    GLint filter;
+    switch (config->vi.interp) {
+        case VI_INTERP_LINEAR:
+            filter = GL_LINEAR;
+            break;
+        case VI_INTERP_NEAREST:
+        default:
+            filter = GL_NEAREST;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+#ifdef HAVE_PBO_STORAGE
+    // check if the staging buffer can be mapped persistently
+    GLint num_extensions;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+
+    ptr_glBufferStorageEXT = NULL;
+    for (GLint i = 0; i < num_extensions; i++) {
+        if (!strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_buffer_storage")) {
+            ptr_glBufferStorageEXT = (PFNGLBUFFERSTORAGEEXTPROC)IntGetProcAddress("glBufferStorageEXT");
+            break;
+        }
+    }
+
+    pbo_supported = ptr_glBufferStorageEXT != NULL;
+    msg_debug("%s: persistently mapped staging buffer %s", __FUNCTION__, pbo_supported ? "enabled" : "not supported");
+#endif
+
+    // check if there was an error when using any of the commands above
+    gl_check_errors();
+}
+
+static void gl_read(struct frame_buffer* fb, bool alpha)
+{
+    GLint vp[4];
+    glGetIntegerv(GL_VIEWPORT, vp);
+
+    fb->width = vp[2];
+    fb->height = vp[3];
+    fb->pitch = fb->width;
+
+    if (fb->pixels) {
+        glReadPixels(vp[0], vp[1], vp[2], vp[3], alpha ? GL_RGBA : GL_RGB, TEX_TYPE, fb->pixels);
+    }
+}
+
+static uint32_t gl_map(size_t size, struct rgba** buffers, uint32_t* index)
+{
+#ifdef HAVE_PBO_STORAGE
+    if (!pbo_supported) {
+        return 0;
+    }
+
+    // buffer storage is immutable, so create larger buffers and keep the
+    // contents of the old ones. the buffers are also read, by this copy and
+    // by n64video_read_screen, so they have to be mapped for reading as well
+    if (size > pbo_size) {
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+
+        for (uint32_t i = 0; i < PBO_NUM; i++) {
+            GLuint new_pbo;
+            glGenBuffers(1, &new_pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, new_pbo);
+            ptr_glBufferStorageEXT(GL_PIXEL_UNPACK_BUFFER, size * sizeof(struct rgba), NULL, flags);
+            struct rgba* new_pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size * sizeof(struct rgba), flags);
+
+            if (!new_pixels) {
+                msg_error("%s: failed to map pixel buffer of %d pixels", __FUNCTION__, (int)size);
+            }
+
+            if (pbo_pixels[i]) {
+                memcpy(new_pixels, pbo_pixels[i], pbo_size * sizeof(struct rgba));
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glDeleteBuffers(1, &pbo[i]);
+            }
+
+            pbo[i] = new_pbo;
+            pbo_pixels[i] = new_pixels;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pbo_size = size;
+    }
+
+    // continue with the buffer that was uploaded the longest time ago, which
+    // has usually been finished by the GPU already
+    pbo_index = (pbo_index + 1) % PBO_NUM;
+
+    if (pbo_fence[pbo_index]) {
+        glClientWaitSync(pbo_fence[pbo_index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(pbo_fence[pbo_index]);
+        pbo_fence[pbo_index] = 0;
+    }
+
+    for (uint32_t i = 0; i < PBO_NUM; i++) {
+        buffers[i] = pbo_pixels[i];
+    }
+
+    *index = pbo_index;
+
+    return PBO_NUM;
+#else
+    (void)size;
+    (void)buffers;
+    (void)index;
+    return 0;
+#endif
+}
+
+static void gl_write(struct frame_buffer* fb)
+{
+    bool buffer_size_changed = tex_width != fb->width || tex_height != fb->height;
+    const void* pixels = fb->pixels;
+
+#ifdef HAVE_PBO_STORAGE
+    // upload from a staging buffer if the frame was filtered into it
+    int32_t from_pbo = -1;
+    for (uint32_t i = 0; i < PBO_NUM; i++) {
+        if (pbo_pixels[i] && fb->pixels >= pbo_pixels[i] && fb->pixels < pbo_pixels[i] + pbo_size) {
+            from_pbo = i;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+            pixels = (const void*)((fb->pixels - pbo_pixels[i]) * sizeof(struct rgba));
+            break;
+        }
+    }
+#endif
+
+    // set pitch for all unpacking operations, which also changes between
+    // frames of the same size
+    if (tex_pitch != fb->pitch) {
+        tex_pitch = fb->pitch;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, tex_pitch);
+    }
+
+    // check if the framebuffer size has changed
+    if (buffer_size_changed) {
+        tex_width = fb->width;
+        tex_height = fb->height;
+
+        // reallocate texture buffer on GPU
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_width,
+            tex_height, 0, TEX_FORMAT, TEX_TYPE, pixels);
+
+        msg_debug("%s: resized framebuffer texture: %dx%d", __FUNCTION__, tex_width, tex_height);
+    } else {
+        // copy local buffer to GPU texture buffer
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_width, tex_height,
+            TEX_FORMAT, TEX_TYPE, pixels);
+    }
+
+#ifdef HAVE_PBO_STORAGE
+    if (from_pbo >= 0) {
+        // the VI must not write to the buffer until this upload has finished
+        if (pbo_fence[from_pbo]) {
+            glDeleteSync(pbo_fence[from_pbo]);
+        }
+        pbo_fence[from_pbo] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+#endif
+
+    // update output size
+    tex_height_out = fb->height_out;
+}
+
+static void gl_sync(bool invalid)
+{
+    // clear old buffers
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // get current window size and position
+    int32_t win_width;
+    int32_t win_height;
+    int32_t win_x;
+    int32_t win_y;
+
+    screen_adjust(tex_width, tex_height_out, &win_width, &win_height, &win_x, &win_y);
+
+    // if the screen is invalid or hidden, do nothing
+    if (win_width <= 0 || win_height <= 0) {
+        return;
+    }
+
+    // skip rendering and leave buffer blank if there's no valid input
+    if (invalid) {
+        screen_update();
+        return;
+    }
+
+    int32_t hw = tex_height_out * win_width;
+    int32_t wh = tex_width * win_height;
+
+    // add letterboxes or pillarboxes if the window has a different aspect ratio
+    // than the current display mode
+    if (hw > wh) {
+        int32_t w_max = wh / tex_height_out;
+        win_x += (win_width - w_max) / 2;
+        win_width = w_max;
+    } else if (hw < wh) {
+        int32_t h_max = hw / tex_width;
+        win_y += (win_height - h_max) / 2;
+        win_height = h_max;
+    }
+
+    // configure viewport
+    glViewport(win_x, win_y, win_width, win_height);
+
+    // draw fullscreen triangle
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // check if there was an error when using any of the commands above
+    gl_check_errors();
+
+    // refresh screen with new frame
+    screen_update();
+}
+
+static void gl_close(void)
+{
+    tex_width = 0;
+    tex_height = 0;
+    tex_pitch = 0;
+
+    tex_height_out = 0;
+
+#ifdef HAVE_PBO_STORAGE
+    for (uint32_t i = 0; i < PBO_NUM; i++) {
+        if (pbo_fence[i]) {
+            glDeleteSync(pbo_fence[i]);
+            pbo_fence[i] = 0;
+        }
+
+        if (pbo[i]) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &pbo[i]);
+            pbo[i] = 0;
+        }
+
+        pbo_pixels[i] = NULL;
+    }
+
+    pbo_size = 0;
+    pbo_index = 0;
+#endif
+
+    glDeleteTextures(1, &texture);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+
+    screen_close();
+}
+
+const struct vdac_backend vdac_gl =
+{
+    .init = gl_init,
+    .read = gl_read,
+    .write = gl_write,
+    .map = gl_map,
+    .sync = gl_sync,
+    .close = gl_close,
+};
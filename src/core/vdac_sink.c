@@ -0,0 +1,132 @@
+#include "vdac.h"
+#include "msg.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ring buffer entry, which holds a packed copy of a frame
+struct sink_slot
+{
+    struct rgba* pixels;
+    size_t size;
+};
+
+static void (*frame_cb)(struct frame_buffer* fb, void* user);
+static void* frame_cb_user;
+
+static struct sink_slot* ring;
+static uint32_t ring_size;
+static uint32_t ring_index;
+
+// last frame that was written and whether it was presented as valid
+static struct frame_buffer frame;
+static bool frame_valid;
+
+static void sink_init(struct n64video_config* config)
+{
+    frame_cb = config->vdac.frame_cb;
+    frame_cb_user = config->vdac.frame_cb_user;
+
+    // frames that are filtered in the background are overwritten by the next
+    // frame before they are presented, so they always have to be copied
+    ring_size = config->vdac.ring_size;
+    if (config->vi.pipelined && !ring_size) {
+        ring_size = 1;
+    }
+
+    if (ring_size) {
+        ring = calloc(ring_size, sizeof(*ring));
+        if (!ring) {
+            msg_error("Failed to allocate %u frame buffers", ring_size);
+        }
+    }
+
+    ring_index = 0;
+
+    memset(&frame, 0, sizeof(frame));
+    frame_valid = false;
+}
+
+static void sink_read(struct frame_buffer* fb, bool alpha)
+{
+    if (!frame_valid) {
+        fb->width = 0;
+        fb->height = 0;
+        fb->pitch = 0;
+        return;
+    }
+
+    vdac_copy(fb, &frame, alpha);
+}
+
+static uint32_t sink_map(size_t size, struct rgba** buffers, uint32_t* index)
+{
+    (void)size;
+    (void)buffers;
+    (void)index;
+
+    // the memory of the VI is just as good as a buffer of our own
+    return 0;
+}
+
+static void sink_write(struct frame_buffer* fb)
+{
+    frame = *fb;
+
+    // pass the frame in place if there's no ring
+    if (!ring_size) {
+        return;
+    }
+
+    struct sink_slot* slot = &ring[ring_index];
+    ring_index = (ring_index + 1) % ring_size;
+
+    size_t size = (size_t)fb->width * fb->height;
+    if (size > slot->size) {
+        slot->pixels = realloc(slot->pixels, size * sizeof(struct rgba));
+        if (!slot->pixels) {
+            msg_error("Failed to allocate frame buffer of %ux%u pixels", fb->width, fb->height);
+        }
+        slot->size = size;
+    }
+
+    for (uint32_t y = 0; y < fb->height; y++) {
+        memcpy(&slot->pixels[y * fb->width], &fb->pixels[y * fb->pitch], fb->width * sizeof(struct rgba));
+    }
+
+    frame.pixels = slot->pixels;
+    frame.pitch = fb->width;
+}
+
+static void sink_sync(bool invalid)
+{
+    frame_valid = !invalid && frame.pixels;
+
+    if (frame_cb) {
+        frame_cb(frame_valid ? &frame : NULL, frame_cb_user);
+    }
+}
+
+static void sink_close(void)
+{
+    for (uint32_t i = 0; i < ring_size; i++) {
+        free(ring[i].pixels);
+    }
+
+    free(ring);
+    ring = NULL;
+    ring_size = 0;
+
+    memset(&frame, 0, sizeof(frame));
+    frame_valid = false;
+}
+
+const struct vdac_backend vdac_sink =
+{
+    .init = sink_init,
+    .read = sink_read,
+    .write = sink_write,
+    .map = sink_map,
+    .sync = sink_sync,
+    .close = sink_close,
+};
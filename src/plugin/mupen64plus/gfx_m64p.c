@@ -28,11 +28,14 @@
 #define KEY_SCREEN_HEIGHT "ScreenHeight"
 #define KEY_PARALLEL "Parallel"
 #define KEY_NUM_WORKERS "NumWorkers"
+#define KEY_AFFINITY "Affinity"
 
 #define KEY_VI_MODE "ViMode"
 #define KEY_VI_INTERP "ViInterpolation"
 #define KEY_VI_WIDESCREEN "ViWidescreen"
 #define KEY_VI_HIDE_OVERSCAN "ViHideOverscan"
+#define KEY_VI_SKIP_UNCHANGED "ViSkipUnchanged"
+#define KEY_VI_PIPELINED "ViPipelined"
 
 #define KEY_DP_COMPAT "DpCompat"
 
@@ -111,10 +114,13 @@ EXPORT m64p_error CALL PluginStartup(m64p_dynlib_handle _CoreLibHandle, void *Co
 
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_PARALLEL, config.parallel, "Distribute rendering between multiple processors if True");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_NUM_WORKERS, config.num_workers, "Rendering Workers (0=Use all logical processors)");
+    ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_AFFINITY, config.affinity, "Pin rendering workers to processors and NUMA nodes if True (Linux only)");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_VI_MODE, config.vi.mode, "VI mode (0=Filtered, 1=Unfiltered, 2=Depth, 3=Coverage)");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_VI_INTERP, config.vi.interp, "Scaling interpolation type (0=NN, 1=Linear)");
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_WIDESCREEN, config.vi.widescreen, "Use anamorphic 16:9 output mode if True");
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_HIDE_OVERSCAN, config.vi.hide_overscan, "Hide overscan area in filteded mode if True");
+    ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_SKIP_UNCHANGED, config.vi.skip_unchanged, "Reuse lines of the last filtered frame the RDP didn't change if True (misses CPU framebuffer writes)");
+    ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_PIPELINED, config.vi.pipelined, "Filter frames on one background thread and present them one frame later if True, which can be slower than filtering on all workers");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_DP_COMPAT, config.dp.compat, "Compatibility mode (0=Fast 1=Moderate 2=Slow");
 
     ConfigSaveSection("Video-General");
@@ -196,10 +202,13 @@ EXPORT int CALL RomOpen (void)
 
     config.parallel = ConfigGetParamBool(configVideoAngrylionPlus, KEY_PARALLEL);
     config.num_workers = ConfigGetParamInt(configVideoAngrylionPlus, KEY_NUM_WORKERS);
+    config.affinity = ConfigGetParamBool(configVideoAngrylionPlus, KEY_AFFINITY);
     config.vi.mode = ConfigGetParamInt(configVideoAngrylionPlus, KEY_VI_MODE);
     config.vi.interp = ConfigGetParamInt(configVideoAngrylionPlus, KEY_VI_INTERP);
     config.vi.widescreen = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_WIDESCREEN);
     config.vi.hide_overscan = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_HIDE_OVERSCAN);
+    config.vi.skip_unchanged = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_SKIP_UNCHANGED);
+    config.vi.pipelined = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_PIPELINED);
 
     config.dp.compat = ConfigGetParamInt(configVideoAngrylionPlus, KEY_DP_COMPAT);
 
@@ -256,7 +265,7 @@ EXPORT void CALL ReadScreen2(void *dest, int *width, int *height, int front)
 {
     struct frame_buffer fb = { 0 };
     fb.pixels = dest;
-    vdac_read(&fb, false);
+    n64video_read_screen(&fb, false);
 
     *width = fb.width;
     *height = fb.height;
@@ -275,12 +284,25 @@ EXPORT void CALL ResizeVideoOutput(int width, int height)
 
 EXPORT void CALL FBWrite(unsigned int addr, unsigned int size)
 {
+    n64video_fb_write(addr, size);
 }
 
 EXPORT void CALL FBRead(unsigned int addr)
 {
+    n64video_fb_read(addr);
 }
 
 EXPORT void CALL FBGetFrameBufferInfo(void *pinfo)
 {
+    // the core fills an array of six entries, unused ones must be zero
+    FrameBufferInfo* info = pinfo;
+    struct n64video_fb_info fb_info[6] = { 0 };
+    n64video_fb_info(fb_info, 6);
+
+    for (int i = 0; i < 6; i++) {
+        info[i].addr = fb_info[i].addr;
+        info[i].size = fb_info[i].size;
+        info[i].width = fb_info[i].width;
+        info[i].height = fb_info[i].height;
+    }
 }
@@ -16,6 +16,7 @@
 
 #define KEY_GEN_PARALLEL "parallel"
 #define KEY_GEN_NUM_WORKERS "num_workers"
+#define KEY_GEN_AFFINITY "affinity"
 
 #define KEY_VI_MODE "mode"
 #define KEY_VI_INTERP "interpolation"
@@ -23,6 +24,8 @@
 #define KEY_VI_HIDE_OVERSCAN "hide_overscan"
 #define KEY_VI_EXCLUSIVE "exclusive"
 #define KEY_VI_VSYNC "vsync"
+#define KEY_VI_SKIP_UNCHANGED "skip_unchanged"
+#define KEY_VI_PIPELINED "pipelined"
 
 #define KEY_DP_COMPAT "compat"
 
@@ -183,6 +186,9 @@ static void config_handle(const char* key, const char* value, const char* sectio
         if (!_strcmpi(key, KEY_GEN_NUM_WORKERS)) {
             config.num_workers = strtoul(value, NULL, 0);
         }
+        if (!_strcmpi(key, KEY_GEN_AFFINITY)) {
+            config.affinity = strtol(value, NULL, 0) != 0;
+        }
     } else if (!_strcmpi(section, SECTION_VIDEO_INTERFACE)) {
         if (!_strcmpi(key, KEY_VI_MODE)) {
             config.vi.mode = strtol(value, NULL, 0);
@@ -196,6 +202,10 @@ static void config_handle(const char* key, const char* value, const char* sectio
             config.vi.exclusive = strtol(value, NULL, 0) != 0;
         } else if (!_strcmpi(key, KEY_VI_VSYNC)) {
             config.vi.vsync = strtol(value, NULL, 0) != 0;
+        } else if (!_strcmpi(key, KEY_VI_SKIP_UNCHANGED)) {
+            config.vi.skip_unchanged = strtol(value, NULL, 0) != 0;
+        } else if (!_strcmpi(key, KEY_VI_PIPELINED)) {
+            config.vi.pipelined = strtol(value, NULL, 0) != 0;
         }
     } else if (!_strcmpi(section, SECTION_DISPLAY_PROCESSOR)) {
         if (!_strcmpi(key, KEY_DP_COMPAT)) {
@@ -296,6 +306,7 @@ bool config_save(void)
     config_write_section(fp, SECTION_GENERAL);
     config_write_int32(fp, KEY_GEN_PARALLEL, config.parallel);
     config_write_uint32(fp, KEY_GEN_NUM_WORKERS, config.num_workers);
+    config_write_int32(fp, KEY_GEN_AFFINITY, config.affinity);
     fputs("\n", fp);
 
     config_write_section(fp, SECTION_VIDEO_INTERFACE);
@@ -305,6 +316,8 @@ bool config_save(void)
     config_write_int32(fp, KEY_VI_HIDE_OVERSCAN, config.vi.hide_overscan);
     config_write_int32(fp, KEY_VI_EXCLUSIVE, config.vi.exclusive);
     config_write_int32(fp, KEY_VI_VSYNC, config.vi.vsync);
+    config_write_int32(fp, KEY_VI_SKIP_UNCHANGED, config.vi.skip_unchanged);
+    config_write_int32(fp, KEY_VI_PIPELINED, config.vi.pipelined);
     fputs("\n", fp);
 
     config_write_section(fp, SECTION_DISPLAY_PROCESSOR);
@@ -298,16 +298,26 @@ EXPORT void CALL ViWidthChanged(void)
 
 EXPORT void CALL FBWrite(DWORD addr, DWORD val)
 {
+    // the second argument is the size of the write
+    n64video_fb_write(addr, val);
 }
 
 EXPORT void CALL FBWList(FrameBufferModifyEntry *plist, DWORD size)
 {
+    for (DWORD i = 0; i < size; i++) {
+        n64video_fb_write(plist[i].addr, plist[i].size);
+    }
 }
 
 EXPORT void CALL FBRead(DWORD addr)
 {
+    n64video_fb_read(addr);
 }
 
 EXPORT void CALL FBGetFrameBufferInfo(void *pinfo)
 {
+    // only the depth buffer is reported here, which is all zero if unknown
+    struct n64video_fb_info info[2] = { 0 };
+    n64video_fb_info(info, 2);
+    *(struct n64video_fb_info*)pinfo = info[1];
 }
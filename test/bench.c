@@ -0,0 +1,276 @@
+// times single stages of the RDP and VI pipelines in isolation and prints
+// the time per call as CSV, to measure micro-optimizations without a game.
+// the state is set up through the RDP command handlers on top of a rendered
+// frame of the synthetic scene, the inputs of each call are random
+//
+// usage: bench [-n calls per stage]
+
+#include "core/n64video.c"
+#include "core/n64video/vi.c"
+#include "scene.h"
+
+// number of random inputs, a power of two
+#define NUM_INPUTS 0x1000
+
+// the scene's images, with 320 pixels per line
+#define BENCH_COLOR_IMAGE 0x100000
+#define BENCH_DEPTH_IMAGE 0x200000
+#define BENCH_TEXTURES 0x300000
+#define BENCH_WIDTH 320
+#define BENCH_HEIGHT 240
+
+// lines covered by the triangle that is drawn during setup
+#define BENCH_TRI_YH 20
+#define BENCH_TRI_YL 200
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t inputs[NUM_INPUTS][4];
+
+// keeps the results alive
+static volatile uint32_t sink;
+
+static void cmd(void (*handler)(uint32_t, const uint32_t*), uint32_t w0, uint32_t w1)
+{
+    uint32_t args[2] = { w0, w1 };
+    handler(0, args);
+}
+
+static void setup(void)
+{
+    struct n64video_config config;
+    n64video_config_init(&config);
+    scene_init(&config, 1, false);
+    config.parallel = false;
+
+    n64video_init(&config);
+
+    // a frame of the scene leaves the color image with coverage for the VI
+    // filters and the depth image with depth values
+    scene_run(scene_build(0, 2000));
+
+    // a 32x32 RGBA 16 bit texture in tile 0, loaded through tile 7
+    cmd(rdp_set_texture_image, (CMD_ID_SET_TEXTURE_IMAGE << 24) | (2 << 19) | 31, BENCH_TEXTURES);
+    cmd(rdp_set_tile, (CMD_ID_SET_TILE << 24) | (2 << 19), 7 << 24);
+    cmd(rdp_load_block, CMD_ID_LOAD_BLOCK << 24, (7 << 24) | (1023 << 12) | 0x80);
+    cmd(rdp_set_tile, (CMD_ID_SET_TILE << 24) | (2 << 19) | (8 << 9), (5 << 14) | (5 << 4));
+    cmd(rdp_set_tile_size, CMD_ID_SET_TILE_SIZE << 24, (31 << 14) | (31 << 2));
+
+    cmd(rdp_set_color_image, (CMD_ID_SET_COLOR_IMAGE << 24) | (2 << 19) | (BENCH_WIDTH - 1), BENCH_COLOR_IMAGE);
+    cmd(rdp_set_mask_image, CMD_ID_SET_MASK_IMAGE << 24, BENCH_DEPTH_IMAGE);
+    cmd(rdp_set_scissor, CMD_ID_SET_SCISSOR << 24, ((BENCH_WIDTH - 1) * 4 << 12) | (BENCH_HEIGHT * 4));
+
+    // (TEXEL0 - 0) * SHADE + 0 for the color and alpha of both cycles
+    cmd(rdp_set_combine, (CMD_ID_SET_COMBINE << 24) | 0x121824, 0x8833ffff);
+
+    // 1 cycle, perspective correct and bilinear without dithering. the
+    // blender mixes the pixel and memory colors by the pixel alpha with
+    // antialiasing and depth compare and update, like an opaque surface
+    cmd(rdp_set_other_modes, (CMD_ID_SET_OTHER_MODES << 24) | 0x82cf0, 0x552078);
+
+    // a triangle without flip computes the spans of its lines and brings the
+    // derived render state up to date
+    uint32_t tri[8] = {
+        (CMD_ID_FILL_TRIANGLE << 24) | (BENCH_TRI_YL * 4),
+        (BENCH_TRI_YL * 4) << 16 | (BENCH_TRI_YH * 4),
+        160 << 16, 0,
+        160 << 16, 1 << 15,
+        160 << 16, (uint32_t)-(1 << 15)
+    };
+    rdp_tri_noshade(0, tri);
+
+    for (uint32_t i = 0; i < NUM_INPUTS; i++) {
+        for (uint32_t k = 0; k < 4; k++) {
+            inputs[i][k] = rng();
+        }
+    }
+}
+
+static uint32_t bench_tcdiv_persp(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        int32_t sss, sst;
+        tcdiv_persp(in[0] & 0xffff, in[1] & 0xffff, (in[2] & 0x7fff) | 1, &sss, &sst);
+        sum += sss + sst;
+    }
+    return sum;
+}
+
+static uint32_t bench_fetch_texel_quadro(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        struct color c0, c1, c2, c3;
+        fetch_texel_quadro(0, &c0, &c1, &c2, &c3, in[0] & 0x1f, in[1] & 1, in[2] & 0x1f, in[3] & 1, 0, 0);
+        sum += c0.r + c1.g + c2.b + c3.a;
+    }
+    return sum;
+}
+
+static uint32_t bench_texture_pipeline_cycle(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        struct color texel;
+        texture_pipeline_cycle(0, &texel, &texel, in[0] & 0xfff, in[1] & 0xfff, 0, 0);
+        sum += texel.r + texel.g + texel.b + texel.a;
+    }
+    return sum;
+}
+
+static uint32_t bench_combiner_1cycle(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        uint32_t cvg = in[2] & 7;
+        state[0].texel0_color.r = in[0] & 0xff;
+        state[0].texel0_color.g = (in[0] >> 8) & 0xff;
+        state[0].texel0_color.b = (in[0] >> 16) & 0xff;
+        state[0].texel0_color.a = in[0] >> 24;
+        state[0].shade_color.r = in[1] & 0xff;
+        state[0].shade_color.g = (in[1] >> 8) & 0xff;
+        state[0].shade_color.b = (in[1] >> 16) & 0xff;
+        state[0].shade_color.a = in[1] >> 24;
+        combiner_1cycle(0, 0, &cvg);
+        sum += state[0].pixel_color.r + state[0].pixel_color.a + cvg;
+    }
+    return sum;
+}
+
+static uint32_t bench_blender_1cycle(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        uint32_t r, g, b;
+        state[0].pixel_color.r = in[0] & 0xff;
+        state[0].pixel_color.g = (in[0] >> 8) & 0xff;
+        state[0].pixel_color.b = (in[0] >> 16) & 0xff;
+        state[0].pixel_color.a = in[0] >> 24;
+        state[0].memory_color.r = in[1] & 0xff;
+        state[0].memory_color.g = (in[1] >> 8) & 0xff;
+        state[0].memory_color.b = (in[1] >> 16) & 0xff;
+        state[0].memory_color.a = in[1] >> 24 & 0xe0;
+        if (blender_1cycle(0, &r, &g, &b, 0, in[2] & 1, 0, (in[2] >> 1) & 7, (in[2] >> 4) & 1)) {
+            sum += r + g + b;
+        }
+    }
+    return sum;
+}
+
+static uint32_t bench_z_compare(uint32_t num)
+{
+    uint32_t zb = state[0].zb_address >> 1;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        uint32_t blend_en, prewrap, cvg = (in[2] & 7) + 1;
+        uint16_t dzpix = in[1] & 0xffff;
+        uint32_t zcur = zb + in[0] % (BENCH_WIDTH * BENCH_HEIGHT);
+        sum += z_compare(0, zcur, in[3] & 0x3ffff, dzpix, dz_compress(dzpix), &blend_en, &prewrap, &cvg, (in[2] >> 3) & 7);
+        sum += blend_en + prewrap + cvg;
+    }
+    return sum;
+}
+
+static uint32_t bench_compute_cvg_noflip(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        int32_t scanline = BENCH_TRI_YH + 1 + i % (BENCH_TRI_YL - BENCH_TRI_YH - 1);
+        compute_cvg_noflip(0, scanline);
+        sum += state[0].cvgbuf[state[0].span[scanline].lx];
+    }
+    return sum;
+}
+
+static uint32_t bench_video_filter16(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        uint32_t pixel = BENCH_WIDTH + 1 + in[0] % (BENCH_WIDTH * (BENCH_HEIGHT - 2) - 2);
+        int r = in[1] & 0xff, g = (in[1] >> 8) & 0xff, b = (in[1] >> 16) & 0xff;
+        video_filter16(&r, &g, &b, BENCH_COLOR_IMAGE, pixel, BENCH_WIDTH, in[2] & 7, 0);
+        sum += r + g + b;
+    }
+    return sum;
+}
+
+static uint32_t bench_restore_filter16(uint32_t num)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t* in = inputs[i & (NUM_INPUTS - 1)];
+        uint32_t pixel = BENCH_WIDTH + 1 + in[0] % (BENCH_WIDTH * (BENCH_HEIGHT - 2) - 2);
+        int r = in[1] & 0xff, g = (in[1] >> 8) & 0xff, b = (in[1] >> 16) & 0xff;
+        restore_filter16(&r, &g, &b, BENCH_COLOR_IMAGE, pixel, BENCH_WIDTH, 0);
+        sum += r + g + b;
+    }
+    return sum;
+}
+
+static const struct
+{
+    const char* name;
+    uint32_t (*run)(uint32_t num);
+} stages[] = {
+    {"tcdiv_persp",            bench_tcdiv_persp},
+    {"fetch_texel_quadro",     bench_fetch_texel_quadro},
+    {"texture_pipeline_cycle", bench_texture_pipeline_cycle},
+    {"combiner_1cycle",        bench_combiner_1cycle},
+    {"blender_1cycle",         bench_blender_1cycle},
+    {"z_compare",              bench_z_compare},
+    {"compute_cvg_noflip",     bench_compute_cvg_noflip},
+    {"video_filter16",         bench_video_filter16},
+    {"restore_filter16",       bench_restore_filter16},
+};
+
+int main(int argc, char** argv)
+{
+    uint32_t num = 10000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "-n")) {
+            num = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n calls per stage]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!num) {
+        num = 1;
+    }
+
+    setup();
+
+    printf("stage,calls,ns_per_call\n");
+    for (uint32_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+        // one call per input first, to warm up the caches
+        sink += stages[i].run(NUM_INPUTS);
+
+        uint64_t start = stats_time();
+        sink += stages[i].run(num);
+        uint64_t time = stats_time() - start;
+
+        printf("%s,%u,%.3f\n", stages[i].name, num, (double)time / num);
+    }
+
+    n64video_close();
+
+    return EXIT_SUCCESS;
+}
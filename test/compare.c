@@ -0,0 +1,255 @@
+// renders the synthetic scene with a reference config and an optimized
+// config, compares the hashes of the color and depth images after each
+// SYNC_FULL and reports the first command and pixel that differ
+//
+// usage: compare [-f frames] [-c commands per frame] [-s seed] [-w workers]
+
+#include "scene.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAMES 1000
+
+struct run_config
+{
+    bool parallel;
+    uint32_t num_workers;
+    enum dp_compat_profile compat;
+    bool skip_unchanged;
+    bool pipelined;
+};
+
+// images as they were after a SYNC_FULL
+struct capture
+{
+    uint32_t num_images;
+    struct n64video_fb_info images[2];
+    uint32_t* words[2];     // copies of the RDRAM words of the images
+    uint64_t* hashes[2];    // hashes of each word, including its hidden bits
+};
+
+// images and hash of the last SYNC_FULL
+static struct n64video_fb_info sync_images[2];
+static uint32_t sync_num_images;
+static uint64_t sync_hash;
+
+static void sync_cb(void)
+{
+    sync_num_images = n64video_fb_info(sync_images, 2);
+    sync_hash = 0;
+
+    for (uint32_t i = 0; i < sync_num_images; i++) {
+        struct n64video_fb_info* image = &sync_images[i];
+        sync_hash = sync_hash * 31 + n64video_fb_hash(image->addr, image->size * image->width * image->height);
+    }
+}
+
+static void capture(struct capture* cap)
+{
+    const uint8_t* rdram = scene_rdram();
+
+    cap->num_images = sync_num_images;
+
+    for (uint32_t i = 0; i < sync_num_images; i++) {
+        struct n64video_fb_info* image = &sync_images[i];
+        uint32_t num_words = (image->size * image->width * image->height + 3) / 4;
+
+        cap->images[i] = *image;
+        cap->words[i] = malloc(num_words * sizeof(uint32_t));
+        cap->hashes[i] = malloc(num_words * sizeof(uint64_t));
+        if (!cap->words[i] || !cap->hashes[i]) {
+            fprintf(stderr, "Failed to allocate capture of %u words\n", num_words);
+            exit(EXIT_FAILURE);
+        }
+
+        uint32_t addr = image->addr & ~3;
+        memcpy(cap->words[i], &rdram[addr], num_words * sizeof(uint32_t));
+        for (uint32_t j = 0; j < num_words; j++) {
+            cap->hashes[i][j] = n64video_fb_hash(addr + j * 4, 4);
+        }
+    }
+}
+
+static void capture_free(struct capture* cap)
+{
+    for (uint32_t i = 0; i < cap->num_images; i++) {
+        free(cap->words[i]);
+        free(cap->hashes[i]);
+    }
+}
+
+// renders all commands of the frames before the last one and the first
+// last_cmds commands of the last one. the hash of the images after each
+// frame is stored to hashes if it's not NULL, the images after the last
+// frame are stored to cap if it's not NULL. returns the hash after the last
+// frame
+static uint64_t play(const struct run_config* rc, uint32_t seed, uint32_t frames, uint32_t cmds, uint32_t last_cmds,
+    uint64_t* hashes, struct capture* cap)
+{
+    struct n64video_config config;
+    n64video_config_init(&config);
+    scene_init(&config, seed, false);
+
+    config.gfx.mi_intr_cb = sync_cb;
+    config.parallel = rc->parallel;
+    config.num_workers = rc->num_workers;
+    config.dp.compat = rc->compat;
+    config.vi.skip_unchanged = rc->skip_unchanged;
+    config.vi.pipelined = rc->pipelined;
+    config.vdac.headless = true;
+
+    n64video_init(&config);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        uint32_t num = scene_build(i, cmds);
+        scene_run(i + 1 < frames ? num : last_cmds);
+        n64video_update_screen();
+
+        if (hashes) {
+            hashes[i] = sync_hash;
+        }
+    }
+
+    if (cap) {
+        capture(cap);
+    }
+
+    n64video_close();
+
+    return sync_hash;
+}
+
+// finds the first pixel that differs between two captures
+static bool find_pixel(const struct capture* ref, const struct capture* opt)
+{
+    for (uint32_t i = 0; i < ref->num_images && i < opt->num_images; i++) {
+        const struct n64video_fb_info* image = &ref->images[i];
+        uint32_t num_words = (image->size * image->width * image->height + 3) / 4;
+        // 4 bit images are reported with a size of 1, so each byte of them
+        // is treated as a pixel
+        uint32_t bits = image->size * 8;
+        uint32_t mask = bits < 32 ? (1 << bits) - 1 : ~0;
+
+        for (uint32_t j = 0; j < num_words; j++) {
+            uint32_t diff = ref->words[i][j] ^ opt->words[i][j];
+            if (!diff && ref->hashes[i][j] == opt->hashes[i][j]) {
+                continue;
+            }
+
+            // pixels at lower addresses are in the upper bits of a word. if
+            // only the hidden bits differ, the first pixel of the word is
+            // reported
+            uint32_t k = 0;
+            while (diff && !((diff >> (32 - bits * (k + 1))) & mask)) {
+                k++;
+            }
+
+            uint32_t shift = 32 - bits * (k + 1);
+            uint32_t pixel = j * (32 / bits) + k;
+            printf("first differing pixel: %s image at 0x%06x, x %u y %u: reference 0x%x, optimized 0x%x%s\n",
+                i ? "depth" : "color", image->addr, pixel % image->width, pixel / image->width,
+                (ref->words[i][j] >> shift) & mask, (opt->words[i][j] >> shift) & mask,
+                diff ? "" : ", only the hidden bits differ");
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 8;
+    uint32_t cmds = 300;
+    uint32_t seed = 1;
+    uint32_t workers = 4;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "-f")) {
+            frames = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-c")) {
+            cmds = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-w")) {
+            workers = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-f frames] [-c commands per frame] [-s seed] [-w workers]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!frames || frames > MAX_FRAMES) {
+        fprintf(stderr, "Number of frames must be 1 to %u\n", MAX_FRAMES);
+        return EXIT_FAILURE;
+    }
+
+    // the reference is serial and filters every frame directly, the
+    // optimized config uses every shortcut there is
+    struct run_config ref = { false, 1, DP_COMPAT_HIGH, false, false };
+    struct run_config opt = { true, workers, DP_COMPAT_LOW, true, true };
+
+    static uint64_t ref_hashes[MAX_FRAMES];
+    static uint64_t opt_hashes[MAX_FRAMES];
+    play(&ref, seed, frames, cmds, ~0, ref_hashes, NULL);
+    play(&opt, seed, frames, cmds, ~0, opt_hashes, NULL);
+
+    uint32_t frame = 0;
+    while (frame < frames && ref_hashes[frame] == opt_hashes[frame]) {
+        frame++;
+    }
+
+    if (frame == frames) {
+        printf("%u frames match\n", frames);
+        return EXIT_SUCCESS;
+    }
+
+    printf("frame %u differs after SYNC_FULL: reference %016llx, optimized %016llx\n",
+        frame, (unsigned long long)ref_hashes[frame], (unsigned long long)opt_hashes[frame]);
+
+    // find the shortest part of the frame after which the images differ,
+    // assuming that they keep differing once they do
+    uint32_t low = 0;
+    uint32_t high = scene_build(frame, cmds);
+
+    if (play(&ref, seed, frame + 1, cmds, 0, NULL, NULL) != play(&opt, seed, frame + 1, cmds, 0, NULL, NULL)) {
+        printf("images differ before the first command of the frame\n");
+        high = 0;
+    }
+
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (play(&ref, seed, frame + 1, cmds, mid, NULL, NULL) != play(&opt, seed, frame + 1, cmds, mid, NULL, NULL)) {
+            high = mid;
+        } else {
+            low = mid;
+        }
+    }
+
+    if (high) {
+        const uint32_t* words;
+        scene_build(frame, cmds);
+        uint32_t len = scene_cmd(high - 1, &words);
+
+        printf("first differing command: %u, ID 0x%02x:", high - 1, words[0] >> 24 & 0x3f);
+        for (uint32_t i = 0; i < len; i++) {
+            printf(" %08x", words[i]);
+        }
+        printf("\n");
+    }
+
+    struct capture ref_cap, opt_cap;
+    play(&ref, seed, frame + 1, cmds, high, NULL, &ref_cap);
+    play(&opt, seed, frame + 1, cmds, high, NULL, &opt_cap);
+
+    if (!find_pixel(&ref_cap, &opt_cap)) {
+        printf("the images are in different places\n");
+    }
+
+    capture_free(&ref_cap);
+    capture_free(&opt_cap);
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,33 @@
+// message functions for the tests and tools, which print to stderr instead
+// of going through a plugin
+
+#include "core/msg.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void msg_error(const char* err, ...)
+{
+    va_list arg;
+    va_start(arg, err);
+    fprintf(stderr, "error: ");
+    vfprintf(stderr, err, arg);
+    fprintf(stderr, "\n");
+    va_end(arg);
+    exit(EXIT_FAILURE);
+}
+
+void msg_warning(const char* err, ...)
+{
+    va_list arg;
+    va_start(arg, err);
+    fprintf(stderr, "warning: ");
+    vfprintf(stderr, err, arg);
+    fprintf(stderr, "\n");
+    va_end(arg);
+}
+
+void msg_debug(const char* err, ...)
+{
+}
@@ -0,0 +1,518 @@
+#include "scene.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// RDRAM layout
+#define SCENE_RDRAM_SIZE 0x800000
+#define SCENE_COLOR_IMAGE 0x100000
+#define SCENE_COLOR_IMAGE_8BIT 0x180000
+#define SCENE_DEPTH_IMAGE 0x200000
+#define SCENE_TEXTURES 0x300000
+#define SCENE_TEXTURES_SIZE 0x10000
+#define SCENE_LIST 0x400000
+
+#define SCENE_WIDTH 320
+#define SCENE_HEIGHT 240
+
+// maximum number of commands of a frame, including its setup, and of their
+// words, with room for the largest triangle command
+#define SCENE_MAX_CMDS 0x4000
+#define SCENE_MAX_WORDS (SCENE_MAX_CMDS * 44)
+
+// command IDs
+#define CMD_TRIANGLE 0x08
+#define CMD_TEX_RECT 0x24
+#define CMD_SYNC_FULL 0x29
+#define CMD_SET_KEY_GB 0x2a
+#define CMD_SET_KEY_R 0x2b
+#define CMD_SET_CONVERT 0x2c
+#define CMD_SET_SCISSOR 0x2d
+#define CMD_SET_PRIM_DEPTH 0x2e
+#define CMD_SET_OTHER_MODES 0x2f
+#define CMD_LOAD_TLUT 0x30
+#define CMD_SET_TILE_SIZE 0x32
+#define CMD_LOAD_BLOCK 0x33
+#define CMD_LOAD_TILE 0x34
+#define CMD_SET_TILE 0x35
+#define CMD_FILL_RECT 0x36
+#define CMD_SET_FILL_COLOR 0x37
+#define CMD_SET_FOG_COLOR 0x38
+#define CMD_SET_BLEND_COLOR 0x39
+#define CMD_SET_PRIM_COLOR 0x3a
+#define CMD_SET_ENV_COLOR 0x3b
+#define CMD_SET_COMBINE 0x3c
+#define CMD_SET_TEXTURE_IMAGE 0x3d
+#define CMD_SET_MASK_IMAGE 0x3e
+#define CMD_SET_COLOR_IMAGE 0x3f
+
+// other modes fields
+#define CYCLE_TYPE_1 0
+#define CYCLE_TYPE_2 1
+#define CYCLE_TYPE_COPY 2
+#define CYCLE_TYPE_FILL 3
+
+static uint32_t rdram[SCENE_RDRAM_SIZE / 4];
+static uint32_t vi_reg[VI_NUM_REG];
+static uint32_t dp_reg[DP_NUM_REG];
+static uint32_t* vi_reg_ptr[VI_NUM_REG];
+static uint32_t* dp_reg_ptr[DP_NUM_REG];
+static uint32_t mi_intr_reg;
+
+static uint32_t scene_seed;
+static bool scene_noise;
+static uint64_t rng_state;
+
+static uint32_t list[SCENE_MAX_WORDS];
+static uint32_t list_len;
+static uint32_t cmd_pos[SCENE_MAX_CMDS + 1];
+static uint32_t cmd_num;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static uint32_t rng32(void)
+{
+    return rng() ^ (rng() << 16);
+}
+
+static int32_t rng_range(int32_t min, int32_t max)
+{
+    return min + (int32_t)(rng() % (uint32_t)(max - min + 1));
+}
+
+static void scene_intr(void)
+{
+}
+
+static void rng_seed(uint32_t seed, uint32_t frame)
+{
+    rng_state = ((uint64_t)seed << 32 | frame) * 0x9e3779b97f4a7c15ULL + 1;
+    for (int i = 0; i < 4; i++) {
+        rng();
+    }
+}
+
+static void emit(const uint32_t* words, uint32_t num)
+{
+    cmd_pos[cmd_num++] = list_len;
+    memcpy(&list[list_len], words, num * sizeof(uint32_t));
+    list_len += num;
+    cmd_pos[cmd_num] = list_len;
+}
+
+static void emit2(uint32_t w0, uint32_t w1)
+{
+    uint32_t words[2] = { w0, w1 };
+    emit(words, 2);
+}
+
+static void emit_triangle(void)
+{
+    uint32_t id = CMD_TRIANGLE + (rng() & 7);
+    uint32_t words[44];
+    int32_t x[3], y[3];
+
+    // vertices in 16.16 and quarter lines, sorted from top to bottom
+    for (int i = 0; i < 3; i++) {
+        x[i] = (int32_t)((uint32_t)rng_range(-20, SCENE_WIDTH + 20) << 16 | (rng() & 0xffff));
+        y[i] = rng_range(-8, (SCENE_HEIGHT + 10) * 4);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 3; j++) {
+            if (y[j] < y[i]) {
+                int32_t t = y[i]; y[i] = y[j]; y[j] = t;
+                t = x[i]; x[i] = x[j]; x[j] = t;
+            }
+        }
+    }
+
+    if (y[2] == y[0]) {
+        y[2] += 4;
+    }
+
+    int64_t dxh = (int64_t)(x[2] - x[0]) * 4 / (y[2] - y[0]);
+    int64_t dxm = y[1] != y[0] ? (int64_t)(x[1] - x[0]) * 4 / (y[1] - y[0]) : 0;
+    int64_t dxl = y[2] != y[1] ? (int64_t)(x[2] - x[1]) * 4 / (y[2] - y[1]) : 0;
+
+    // the major edge is on the left if the middle vertex is on the right
+    int64_t cross = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+    uint32_t flip = cross > 0;
+
+    words[0] = (id << 24) | (flip << 23) | ((rng() & 7) << 19) | ((rng() & 7) << 16) | (y[2] & 0x3fff);
+    words[1] = ((y[1] & 0x3fff) << 16) | (y[0] & 0x3fff);
+    words[2] = x[1];
+    words[3] = (uint32_t)dxl;
+    words[4] = x[0];
+    words[5] = (uint32_t)dxh;
+    words[6] = x[0];
+    words[7] = (uint32_t)dxm;
+
+    uint32_t num = 8;
+
+    // shade coefficients, with small gradients so the colors stay in range
+    // for a while
+    if (id & 4) {
+        for (int i = 0; i < 16; i++) {
+            uint32_t value = rng32();
+            words[num++] = i < 2 ? value : (uint32_t)((int32_t)value >> rng_range(4, 12));
+        }
+    }
+
+    // texture coefficients
+    if (id & 2) {
+        for (int i = 0; i < 16; i++) {
+            uint32_t value = rng32();
+            words[num++] = i < 2 ? value : (uint32_t)((int32_t)value >> rng_range(6, 14));
+        }
+    }
+
+    // depth coefficients
+    if (id & 1) {
+        words[num++] = rng() << 8;
+        words[num++] = (uint32_t)((int32_t)(rng() << 16) >> 12);
+        words[num++] = (uint32_t)((int32_t)(rng() << 16) >> 12);
+        words[num++] = (uint32_t)((int32_t)(rng() << 16) >> 12);
+    }
+
+    emit(words, num);
+}
+
+static void emit_rect(bool textured)
+{
+    uint32_t xh = rng_range(0, (SCENE_WIDTH + 10) * 4);
+    uint32_t yh = rng_range(0, (SCENE_HEIGHT + 10) * 4);
+    uint32_t xl = xh + rng_range(0, 100 * 4);
+    uint32_t yl = yh + rng_range(0, 60 * 4);
+
+    if (textured) {
+        uint32_t words[4];
+        words[0] = ((CMD_TEX_RECT + (rng() & 1)) << 24) | ((xl & 0xfff) << 12) | (yl & 0xfff);
+        words[1] = ((rng() & 7) << 24) | ((xh & 0xfff) << 12) | (yh & 0xfff);
+        words[2] = rng32();
+        words[3] = rng32();
+        emit(words, 4);
+    } else {
+        emit2((CMD_FILL_RECT << 24) | ((xl & 0xfff) << 12) | (yl & 0xfff), ((xh & 0xfff) << 12) | (yh & 0xfff));
+    }
+}
+
+// replaces a value of a field of a command word
+static uint32_t replace_field(uint32_t word, uint32_t shift, uint32_t mask, uint32_t from, uint32_t to)
+{
+    return ((word >> shift) & mask) == from ? (word & ~(mask << shift)) | (to << shift) : word;
+}
+
+static void emit_other_modes(void)
+{
+    uint32_t w0 = (CMD_SET_OTHER_MODES << 24) | (rng() & 0xfffff0);
+    uint32_t w1 = rng32();
+
+    uint32_t cycle_type = rng() % 10;
+    cycle_type = cycle_type < 4 ? CYCLE_TYPE_1 : cycle_type < 8 ? CYCLE_TYPE_2 :
+        cycle_type == 8 ? CYCLE_TYPE_COPY : CYCLE_TYPE_FILL;
+    w0 = (w0 & ~(3 << 20)) | (cycle_type << 20);
+
+    // fill mode must not read or update the depth image
+    if (cycle_type == CYCLE_TYPE_FILL) {
+        w1 &= ~((1 << 6) | (1 << 5) | (1 << 4));
+    }
+
+    // no noise dithering of the color and alpha and no random alpha compare.
+    // the first cycle of the blender sees the memory color and depth of the
+    // previous pixel, which is on another worker at the start of each span,
+    // so the pixel color and alpha are blended instead
+    if (!scene_noise) {
+        w0 |= 0xf0;
+        w1 &= ~(1 << 1);
+        w1 = replace_field(w1, 30, 3, 1, 0);
+        w1 = replace_field(w1, 22, 3, 1, 0);
+        w1 = replace_field(w1, 18, 3, 1, 0);
+    }
+
+    emit2(w0, w1);
+}
+
+static void emit_combine(void)
+{
+    uint32_t w0 = (CMD_SET_COMBINE << 24) | (rng() & 0xffffff);
+    uint32_t w1 = rng32();
+
+    if (!scene_noise) {
+        // the combined color and alpha and the LOD fraction are left over
+        // from the previous pixel, which is on another scanline and thus on
+        // another worker at the start of each span. they are replaced with
+        // the texel 0 inputs that follow them, the LOD fraction with the
+        // primitive LOD fraction
+        static const uint32_t w0_fields[][2] = { { 20, 0xf }, { 15, 0x1f }, { 12, 7 }, { 9, 7 }, { 5, 0xf }, { 0, 0x1f } };
+        static const uint32_t w1_fields[][2] = { { 28, 0xf }, { 24, 0xf }, { 21, 7 }, { 18, 7 }, { 15, 7 }, { 12, 7 },
+            { 9, 7 }, { 6, 7 }, { 3, 7 }, { 0, 7 } };
+
+        for (uint32_t i = 0; i < 6; i++) {
+            w0 = replace_field(w0, w0_fields[i][0], w0_fields[i][1], 0, 1);
+        }
+        for (uint32_t i = 0; i < 10; i++) {
+            w1 = replace_field(w1, w1_fields[i][0], w1_fields[i][1], 0, 1);
+        }
+        for (uint32_t shift = 0; shift <= 15; shift += 15) {
+            w0 = replace_field(w0, shift, 0x1f, 7, 8);
+            w0 = replace_field(w0, shift, 0x1f, 13, 14);
+        }
+
+        // replace the noise input of the RGB minuends with the one below
+        w0 = replace_field(w0, 20, 0xf, 7, 6);
+        w0 = replace_field(w0, 5, 0xf, 7, 6);
+    }
+
+    emit2(w0, w1);
+}
+
+static void emit_cmd(void)
+{
+    switch (rng() % 32) {
+        case 0:
+            emit_combine();
+            break;
+
+        case 1:
+        case 2:
+            emit_other_modes();
+            break;
+
+        case 3:
+            emit2(CMD_SET_PRIM_COLOR << 24 | (rng() & 0x1fff), rng32());
+            break;
+
+        case 4:
+            emit2(CMD_SET_ENV_COLOR << 24, rng32());
+            break;
+
+        case 5:
+            emit2(CMD_SET_BLEND_COLOR << 24, rng32());
+            break;
+
+        case 6:
+            emit2(CMD_SET_FOG_COLOR << 24, rng32());
+            break;
+
+        case 7:
+            emit2(CMD_SET_FILL_COLOR << 24, rng32());
+            break;
+
+        case 8:
+            emit2(CMD_SET_PRIM_DEPTH << 24, rng32());
+            break;
+
+        case 9:
+            emit2((CMD_SET_TILE << 24) | ((rng() & 0x1f) << 19) | ((rng() & 0x1f) << 9) | (rng() & 0x1ff),
+                ((rng() & 7) << 24) | (rng() & 0xffffff));
+            break;
+
+        case 10:
+            emit2((CMD_SET_TILE_SIZE << 24) | (rng() & 0xffffff), ((rng() & 7) << 24) | (rng() & 0xffffff));
+            break;
+
+        case 11:
+            // textures are only loaded from an area that is never rendered to
+            emit2((CMD_SET_TEXTURE_IMAGE << 24) | ((rng() & 7) << 21) | ((1 + rng() % 3) << 19) | (rng() & 0x3ff),
+                SCENE_TEXTURES + (rng() & (SCENE_TEXTURES_SIZE / 4 - 1) & ~0xf));
+            break;
+
+        case 12:
+            emit2((CMD_LOAD_BLOCK << 24) | (rng() & 0xffffff), ((rng() & 7) << 24) | (rng() & 0x3ff) << 12 | (rng() & 0xfff));
+            break;
+
+        case 13:
+            emit2((CMD_LOAD_TILE << 24) | (rng() & 0xffffff), ((rng() & 7) << 24) | (rng() & 0xffffff));
+            break;
+
+        case 14: {
+            uint32_t tl = rng() & 0xfff;
+            emit2((CMD_LOAD_TLUT << 24) | (rng() & 0xfff) << 12 | tl, ((rng() & 7) << 24) | (rng() & 0xfff) << 12 | tl);
+            break;
+        }
+
+        case 15: {
+            // keep within the width of the color image, so that each line of
+            // the images is only written by the primitives covering it
+            uint32_t xh = rng_range(8 * 4, 40 * 4);
+            uint32_t yh = rng_range(0, 40 * 4);
+            uint32_t xl = rng_range(200 * 4, (SCENE_WIDTH - 8) * 4);
+            uint32_t yl = rng_range(150 * 4, (SCENE_HEIGHT + 5) * 4);
+            uint32_t field = rng() % 8 ? 0 : (rng() & 3) << 24;
+            emit2((CMD_SET_SCISSOR << 24) | (xh << 12) | yh, field | (xl << 12) | yl);
+            break;
+        }
+
+        case 16: {
+            // mostly 16 bit RGBA, sometimes as 8 bit or intensity
+            uint32_t size = rng() % 10 ? 2 : 1;
+            uint32_t format = rng() % 8 ? 0 : 4;
+            // the lines of an 8 bit image would overlap other lines of the
+            // 16 bit one, so it has its own area
+            emit2((CMD_SET_COLOR_IMAGE << 24) | (format << 21) | (size << 19) | (SCENE_WIDTH - 1),
+                size == 2 ? SCENE_COLOR_IMAGE : SCENE_COLOR_IMAGE_8BIT);
+            break;
+        }
+
+        case 17:
+            emit2(CMD_SET_KEY_GB << 24 | (rng() & 0xffffff), rng32());
+            break;
+
+        case 18:
+            emit2(CMD_SET_CONVERT << 24 | (rng() & 0xffffff), rng32());
+            break;
+
+        case 19:
+            emit_rect(false);
+            break;
+
+        case 20:
+        case 21:
+            emit_rect(true);
+            break;
+
+        default:
+            emit_triangle();
+            break;
+    }
+}
+
+void scene_init(struct n64video_config* config, uint32_t seed, bool noise)
+{
+    scene_seed = seed;
+    scene_noise = noise;
+
+    // the textures are random, the rest starts out cleared
+    memset(rdram, 0, sizeof(rdram));
+    rng_seed(seed, ~0);
+    for (uint32_t i = 0; i < SCENE_TEXTURES_SIZE / 4; i++) {
+        rdram[SCENE_TEXTURES / 4 + i] = rng32();
+    }
+
+    for (uint32_t i = 0; i < VI_NUM_REG; i++) {
+        vi_reg[i] = 0;
+        vi_reg_ptr[i] = &vi_reg[i];
+    }
+
+    for (uint32_t i = 0; i < DP_NUM_REG; i++) {
+        dp_reg[i] = 0;
+        dp_reg_ptr[i] = &dp_reg[i];
+    }
+
+    // 320x240 16 bit NTSC mode with resampling, gamma correction and divot
+    // filter, dithered if noise is enabled
+    vi_reg[VI_STATUS] = 0x321a | (noise ? 4 : 0);
+    vi_reg[VI_ORIGIN] = SCENE_COLOR_IMAGE;
+    vi_reg[VI_WIDTH] = SCENE_WIDTH;
+    vi_reg[VI_V_SYNC] = 525;
+    vi_reg[VI_H_START] = (108 << 16) | (108 + 640);
+    vi_reg[VI_V_START] = (37 << 16) | (37 + 480);
+    vi_reg[VI_X_SCALE] = 1024 * SCENE_WIDTH / 640;
+    vi_reg[VI_Y_SCALE] = 1024 * SCENE_HEIGHT / 240;
+
+    mi_intr_reg = 0;
+
+    config->gfx.rdram = (uint8_t*)rdram;
+    config->gfx.rdram_size = SCENE_RDRAM_SIZE;
+    config->gfx.dmem = (uint8_t*)rdram;
+    config->gfx.vi_reg = vi_reg_ptr;
+    config->gfx.dp_reg = dp_reg_ptr;
+    config->gfx.mi_intr_reg = &mi_intr_reg;
+    config->gfx.mi_intr_cb = scene_intr;
+
+    list_len = 0;
+    cmd_num = 0;
+}
+
+uint32_t scene_build(uint32_t frame, uint32_t num_cmds)
+{
+    rng_seed(scene_seed, frame);
+
+    list_len = 0;
+    cmd_num = 0;
+
+    // clear the depth image in fill mode
+    emit2((CMD_SET_SCISSOR << 24), ((SCENE_WIDTH - 1) * 4 << 12) | (SCENE_HEIGHT * 4));
+    emit2((CMD_SET_OTHER_MODES << 24) | (CYCLE_TYPE_FILL << 20), 0);
+    emit2((CMD_SET_COLOR_IMAGE << 24) | (2 << 19) | (SCENE_WIDTH - 1), SCENE_DEPTH_IMAGE);
+    emit2(CMD_SET_FILL_COLOR << 24, 0xfffcfffc);
+    emit2((CMD_FILL_RECT << 24) | ((SCENE_WIDTH - 1) * 4 << 12) | ((SCENE_HEIGHT - 1) * 4), 0);
+
+    // clear the color image to a color of the frame
+    emit2((CMD_SET_COLOR_IMAGE << 24) | (2 << 19) | (SCENE_WIDTH - 1), SCENE_COLOR_IMAGE);
+    emit2((CMD_SET_MASK_IMAGE << 24), SCENE_DEPTH_IMAGE);
+    emit2(CMD_SET_FILL_COLOR << 24, rng32());
+    emit2((CMD_FILL_RECT << 24) | ((SCENE_WIDTH - 1) * 4 << 12) | ((SCENE_HEIGHT - 1) * 4), 0);
+
+    // copy mode writes up to 8 pixels at once and a byte before the start of
+    // a span, which must not reach into the neighbouring lines
+    emit2((CMD_SET_SCISSOR << 24) | (8 * 4 << 12), ((SCENE_WIDTH - 8) * 4 << 12) | (SCENE_HEIGHT * 4));
+
+    // the texture image starts out as 4 bit, which crashes the RDP on loads
+    emit2((CMD_SET_TEXTURE_IMAGE << 24) | (2 << 19) | 31, SCENE_TEXTURES);
+
+    // the RDP state outlives n64video_close, so everything the random
+    // commands may use is reset to make the frame independent of earlier
+    // runs in the same process. TMEM is filled through tile 7 first
+    emit2((CMD_SET_TILE << 24) | (2 << 19), 7 << 24);
+    emit2(CMD_LOAD_BLOCK << 24, (7 << 24) | (0x7ff << 12));
+    for (uint32_t i = 0; i < 8; i++) {
+        emit2(CMD_SET_TILE << 24, i << 24);
+        emit2(CMD_SET_TILE_SIZE << 24, i << 24);
+    }
+
+    // the combiner passes the shade color through, its zeroes would select
+    // the combined color of the previous pixel
+    emit2((CMD_SET_COMBINE << 24) | 0xffffff, 0xfffe793c);
+    emit2(CMD_SET_FOG_COLOR << 24, 0);
+    emit2(CMD_SET_BLEND_COLOR << 24, 0);
+    emit2(CMD_SET_PRIM_COLOR << 24, 0);
+    emit2(CMD_SET_ENV_COLOR << 24, 0);
+    emit2(CMD_SET_KEY_GB << 24, 0);
+    emit2(CMD_SET_KEY_R << 24, 0);
+    emit2(CMD_SET_CONVERT << 24, 0);
+    emit2(CMD_SET_PRIM_DEPTH << 24, 0);
+
+    if (num_cmds > SCENE_MAX_CMDS) {
+        num_cmds = SCENE_MAX_CMDS;
+    }
+
+    while (cmd_num < num_cmds) {
+        emit_cmd();
+    }
+
+    return cmd_num;
+}
+
+void scene_run(uint32_t num_cmds)
+{
+    uint32_t len = cmd_pos[num_cmds < cmd_num ? num_cmds : cmd_num];
+
+    memcpy(&rdram[SCENE_LIST / 4], list, len * sizeof(uint32_t));
+    rdram[SCENE_LIST / 4 + len++] = CMD_SYNC_FULL << 24;
+    rdram[SCENE_LIST / 4 + len++] = 0;
+
+    dp_reg[DP_STATUS] = 0;
+    dp_reg[DP_START] = dp_reg[DP_CURRENT] = SCENE_LIST;
+    dp_reg[DP_END] = SCENE_LIST + len * 4;
+
+    n64video_process_list();
+}
+
+uint32_t scene_cmd(uint32_t index, const uint32_t** words)
+{
+    *words = &list[cmd_pos[index]];
+    return cmd_pos[index + 1] - cmd_pos[index];
+}
+
+const uint8_t* scene_rdram(void)
+{
+    return (const uint8_t*)rdram;
+}
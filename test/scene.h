@@ -0,0 +1,33 @@
+#pragma once
+
+#include "core/n64video.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// synthetic workload for the tools, which stands in for recorded games. each
+// frame clears a 320x240 16 bit color image and its depth image and renders
+// random primitives with random render modes and textures into them. the
+// frames only depend on the seed and their number, so they can be replayed
+// in any configuration.
+
+// sets up RDRAM and the registers of the config, which has to be passed to
+// n64video_init afterwards. noise and dithering that depend on the random
+// generator of each worker and inputs that are left over from the previous
+// pixel, which is on another worker at the start of a span, are left out
+// unless noise is true
+void scene_init(struct n64video_config* config, uint32_t seed, bool noise);
+
+// generates the commands of a frame with about num_cmds commands and returns
+// their actual number
+uint32_t scene_build(uint32_t frame, uint32_t num_cmds);
+
+// runs the first num_cmds commands of the last generated frame, followed by a
+// SYNC_FULL
+void scene_run(uint32_t num_cmds);
+
+// returns the words of a command of the last generated frame and their number
+uint32_t scene_cmd(uint32_t index, const uint32_t** words);
+
+// returns the RDRAM of the scene
+const uint8_t* scene_rdram(void);
@@ -0,0 +1,35 @@
+// stand-ins for the window functions of a plugin, for tools that link the
+// core library and only use its headless output
+
+#include "core/screen.h"
+
+#include <stddef.h>
+
+void screen_init(struct n64video_config* config)
+{
+}
+
+void screen_adjust(int32_t width_out, int32_t height_out, int32_t* width, int32_t* height, int32_t* x, int32_t* y)
+{
+    *width = width_out;
+    *height = height_out;
+    *x = 0;
+    *y = 0;
+}
+
+void screen_update(void)
+{
+}
+
+void screen_toggle_fullscreen(void)
+{
+}
+
+void screen_close(void)
+{
+}
+
+void* IntGetProcAddress(const char *name)
+{
+    return NULL;
+}
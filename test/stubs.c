@@ -0,0 +1,35 @@
+// stand-ins for the output functions that tests which include the core
+// sources directly have to provide themselves
+
+#include "core/vdac.h"
+
+void vdac_init(struct n64video_config* config)
+{
+}
+
+void vdac_read(struct frame_buffer* fb, bool alpha)
+{
+    fb->width = 0;
+    fb->height = 0;
+}
+
+uint32_t vdac_map(size_t size, struct rgba** buffers, uint32_t* index)
+{
+    return 0;
+}
+
+void vdac_write(struct frame_buffer* fb)
+{
+}
+
+void vdac_sync(bool invalid)
+{
+}
+
+void vdac_close(void)
+{
+}
+
+void vdac_copy(struct frame_buffer* dst, const struct frame_buffer* src, bool alpha)
+{
+}
@@ -0,0 +1,178 @@
+// renders the synthetic scene headless with every combination of worker
+// count and compatibility profile and prints the distribution of the frame
+// times and the VI row throughput as CSV or JSON, to see where the scaling
+// flattens on a host
+//
+// usage: sweep [-f frames] [-c commands per frame] [-s seed] [-w max workers] [-j]
+
+#include "scene.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// frames that are rendered before the measured ones
+#define WARMUP_FRAMES 4
+
+static const char* compat_names[DP_COMPAT_NUM] = { "low", "medium", "high" };
+
+struct result
+{
+    uint32_t workers;
+    enum dp_compat_profile compat;
+    uint64_t frame_p50;
+    uint64_t frame_p99;
+    uint64_t wait_p50;
+    uint64_t wait_p99;
+    double vi_rows_per_s;   // rows filtered by the VI per second of VI time
+};
+
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// nearest-rank percentile of sorted values
+static uint64_t percentile(const uint64_t* values, uint32_t num, uint32_t p)
+{
+    uint32_t rank = (num * p + 99) / 100;
+    return values[rank ? rank - 1 : 0];
+}
+
+// renders the frames with a config and returns the number of workers that
+// were actually used
+static uint32_t run(uint32_t workers, enum dp_compat_profile compat, uint32_t seed, uint32_t frames, uint32_t cmds,
+    uint64_t* frame_times, uint64_t* wait_times, double* vi_rows_per_s)
+{
+    uint64_t vi_rows = 0;
+    uint64_t vi_time = 0;
+
+    struct n64video_config config;
+    n64video_config_init(&config);
+    scene_init(&config, seed, true);
+
+    config.parallel = true;
+    config.num_workers = workers;
+    config.dp.compat = compat;
+    config.vdac.headless = true;
+    config.stats = true;
+
+    n64video_init(&config);
+
+    struct n64video_frame_stats stats = { 0 };
+    for (uint32_t i = 0; i < WARMUP_FRAMES + frames; i++) {
+        uint32_t num = scene_build(i, cmds);
+        scene_run(num);
+        n64video_update_screen();
+        n64video_get_frame_stats(&stats);
+
+        if (i >= WARMUP_FRAMES) {
+            frame_times[i - WARMUP_FRAMES] = stats.process_list + stats.vi + stats.vdac_write + stats.vdac_sync;
+            wait_times[i - WARMUP_FRAMES] = stats.wait;
+            vi_rows += stats.vi_rows;
+            vi_time += stats.vi;
+        }
+    }
+
+    n64video_close();
+
+    *vi_rows_per_s = vi_time ? vi_rows * 1e9 / vi_time : 0;
+
+    return stats.num_workers;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 100;
+    uint32_t cmds = 2000;
+    uint32_t seed = 1;
+    uint32_t max_workers = 0;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j")) {
+            json = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-f")) {
+            frames = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-c")) {
+            cmds = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-w")) {
+            max_workers = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-f frames] [-c commands per frame] [-s seed] [-w max workers] [-j]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!frames) {
+        frames = 1;
+    }
+
+    uint64_t* frame_times = malloc(frames * sizeof(uint64_t));
+    uint64_t* wait_times = malloc(frames * sizeof(uint64_t));
+    if (!frame_times || !wait_times) {
+        fprintf(stderr, "Failed to allocate frame times\n");
+        return EXIT_FAILURE;
+    }
+
+    // one worker per hardware thread by default, as the core picks it
+    if (!max_workers) {
+        double vi_rows_per_s;
+        max_workers = run(0, DP_COMPAT_MEDIUM, seed, 1, 1, frame_times, wait_times, &vi_rows_per_s);
+    }
+
+    // powers of two up to the maximum and the maximum itself
+    struct result results[64 * DP_COMPAT_NUM];
+    uint32_t num_results = 0;
+
+    for (uint32_t workers = 1;; workers = workers * 2 < max_workers ? workers * 2 : max_workers) {
+        for (uint32_t compat = 0; compat < DP_COMPAT_NUM; compat++) {
+            struct result* result = &results[num_results++];
+            result->workers = run(workers, compat, seed, frames, cmds, frame_times, wait_times, &result->vi_rows_per_s);
+            result->compat = compat;
+
+            qsort(frame_times, frames, sizeof(uint64_t), compare_u64);
+            qsort(wait_times, frames, sizeof(uint64_t), compare_u64);
+            result->frame_p50 = percentile(frame_times, frames, 50);
+            result->frame_p99 = percentile(frame_times, frames, 99);
+            result->wait_p50 = percentile(wait_times, frames, 50);
+            result->wait_p99 = percentile(wait_times, frames, 99);
+        }
+
+        if (workers == max_workers) {
+            break;
+        }
+    }
+
+    // times in milliseconds
+    if (json) {
+        printf("[\n");
+        for (uint32_t i = 0; i < num_results; i++) {
+            struct result* r = &results[i];
+            printf("  {\"workers\": %u, \"compat\": \"%s\", \"frames\": %u, "
+                "\"frame_p50_ms\": %.3f, \"frame_p99_ms\": %.3f, \"wait_p50_ms\": %.3f, \"wait_p99_ms\": %.3f, "
+                "\"vi_rows_per_s\": %.0f}%s\n",
+                r->workers, compat_names[r->compat], frames,
+                r->frame_p50 / 1e6, r->frame_p99 / 1e6, r->wait_p50 / 1e6, r->wait_p99 / 1e6,
+                r->vi_rows_per_s, i + 1 < num_results ? "," : "");
+        }
+        printf("]\n");
+    } else {
+        printf("workers,compat,frames,frame_p50_ms,frame_p99_ms,wait_p50_ms,wait_p99_ms,vi_rows_per_s\n");
+        for (uint32_t i = 0; i < num_results; i++) {
+            struct result* r = &results[i];
+            printf("%u,%s,%u,%.3f,%.3f,%.3f,%.3f,%.0f\n", r->workers, compat_names[r->compat], frames,
+                r->frame_p50 / 1e6, r->frame_p99 / 1e6, r->wait_p50 / 1e6, r->wait_p99 / 1e6,
+                r->vi_rows_per_s);
+        }
+    }
+
+    free(frame_times);
+    free(wait_times);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// checks video_max_optimized_rgb against three calls of the scalar
+// video_max_optimized for all pixel counts the VI filter passes to it
+
+#include "core/n64video/vi.c"
+
+#include <stdio.h>
+
+#define NUM_RANDOM 2000000
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t failed;
+static uint32_t checked;
+
+static void check(uint32_t* back[3], int num)
+{
+    uint32_t penumin[3], penumax[3];
+    video_max_optimized_rgb(back[0], back[1], back[2], penumin, penumax, num);
+
+    for (int c = 0; c < 3; c++) {
+        uint32_t refmin, refmax;
+        video_max_optimized(back[c], &refmin, &refmax, num);
+
+        if (penumin[c] != refmin || penumax[c] != refmax) {
+            if (failed < 10) {
+                printf("channel %d of", c);
+                for (int i = 0; i < num; i++) {
+                    printf(" %u", back[c][i]);
+                }
+                printf(": min/max is %u/%u, expected %u/%u\n", penumin[c], penumax[c], refmin, refmax);
+            }
+            failed++;
+            break;
+        }
+    }
+
+    checked++;
+}
+
+int main(void)
+{
+    uint32_t backr[7], backg[7], backb[7];
+    uint32_t* back[3] = { backr, backg, backb };
+
+    // every order of up to four distinct values, including all ties, in red,
+    // with green and blue running in other orders at the same time
+    static const uint32_t values[4] = { 0, 8, 248, 255 };
+    for (int num = 1; num <= 7; num++) {
+        uint32_t combinations = 1 << (2 * num);
+        for (uint32_t n = 0; n < combinations; n++) {
+            for (int i = 0; i < num; i++) {
+                backr[i] = values[(n >> (2 * i)) & 3];
+                backg[i] = values[3 - ((n >> (2 * i)) & 3)];
+                backb[i] = values[rng() & 3];
+            }
+            check(back, num);
+        }
+    }
+
+    // random pixels with narrow ranges for many ties and the full range of
+    // 5 and 8 bit channels
+    for (uint32_t n = 0; n < NUM_RANDOM; n++) {
+        int num = 1 + n % 7;
+        uint32_t range = (n / 7) % 3;
+        for (int c = 0; c < 3; c++) {
+            for (int i = 0; i < num; i++) {
+                uint32_t value = rng();
+                switch (range) {
+                    case 0: value %= 3; break;
+                    case 1: value = (value & 0x1f) << 3; break;
+                    case 2: value &= 0xff; break;
+                }
+                back[c][i] = value;
+            }
+        }
+        check(back, num);
+    }
+
+    printf("%u of %u pixel sets differ\n", failed, checked);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}